@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "automata/DFA.hpp"
+#include "benchmark.hpp"
+
+struct AutomataConfig {
+    std::size_t states;
+    std::size_t actions;
+    std::size_t inputLength;
+};
+
+std::vector<std::size_t> random_transitions(const AutomataConfig &config) {
+    std::default_random_engine randomness(config.states * 31 + config.actions);
+    std::uniform_int_distribution<std::size_t> state(0, config.states - 1);
+
+    std::vector<std::size_t> transitions(config.states * config.actions);
+    for (auto &t : transitions)
+        t = state(randomness);
+    return transitions;
+}
+
+std::vector<std::uint8_t> random_input(const AutomataConfig &config) {
+    std::default_random_engine randomness(config.inputLength);
+    std::uniform_int_distribution<int> action(0, config.actions - 1);
+
+    std::vector<std::uint8_t> input(config.inputLength);
+    for (auto &a : input)
+        a = static_cast<std::uint8_t>(action(randomness));
+    return input;
+}
+
+void performance_dfa(const std::string &name,
+                     hx::DFA &dfa,
+                     std::uint8_t flags,
+                     const std::vector<std::uint8_t> &input) {
+    auto compile_start = std::chrono::high_resolution_clock::now();
+    dfa.compile(flags);
+    auto compile_stop = std::chrono::high_resolution_clock::now();
+
+    std::size_t finalState;
+    {
+        START_MEASURE(name.c_str());
+        dfa.reset();
+        finalState = dfa.process(input.data(), input.data() + input.size());
+        STOP_MEASURE();
+
+        auto compile_time =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(compile_stop
+                                                                 - compile_start);
+        std::cout << "    compile: " << compile_time.count() / 1000000.0 << " ms"
+                  << ", table memory: " << dfa.getTransitionFunction().memorySize() / 1024.0
+                  << " KiB, throughput: " << input.size() * 1000.0 / elapsed.count()
+                  << " Msymbols/s (final state " << finalState << ")" << std::endl;
+    }
+}
+
+void performance_config(const AutomataConfig &config) {
+    auto transitions = random_transitions(config);
+    auto input = random_input(config);
+    auto actions = config.actions;
+
+    std::cout << "== states: " << config.states << ", actions: " << config.actions
+              << ", input: " << config.inputLength << " ("
+              << sizeof(std::size_t) * config.states * config.actions / 1024
+              << " KiB dense table)" << std::endl;
+
+    // std::unordered_map gets too slow to build past a few million entries
+    if (config.states * config.actions <= (1 << 18)) {
+        hx::TransitionFunctionMap::ContainerMap map;
+        for (std::size_t s = 0; s < config.states; ++s) {
+            for (std::size_t a = 0; a < config.actions; ++a)
+                map[{s, a}] = transitions[s * actions + a];
+        }
+        hx::DFA dfa(map, 0, {0});
+        performance_dfa("  TransitionFunctionMap", dfa, 0, input);
+    }
+
+    auto function = [&transitions, actions](std::size_t s, std::size_t a) {
+        return transitions[s * actions + a];
+    };
+
+    hx::DFA dfaFunc(function, 0, {0}, config.states, config.actions);
+    performance_dfa("  TransitionFunctionFunc", dfaFunc, 0, input);
+
+    hx::DFA dfaTable(function, 0, {0}, config.states, config.actions);
+    performance_dfa("  TransitionFunctionTable",
+                    dfaTable,
+                    hx::DFA::flags::CREATE_DYNAMIC_TABLE,
+                    input);
+
+    hx::DFA dfaReduced(function, 0, {0}, config.states, config.actions);
+    performance_dfa(config.states <= hx::TransitionFunctionShuffle::MAX_STATES
+                        ? "  REDUCE_STATE_TABLE (shuffle)"
+                        : "  REDUCE_STATE_TABLE (indirect)",
+                    dfaReduced,
+                    hx::DFA::flags::REDUCE_STATE_TABLE,
+                    input);
+
+    hx::DFA dfaCompressed(function, 0, {0}, config.states, config.actions);
+    performance_dfa("  COMPRESS_STATE_TABLE",
+                    dfaCompressed,
+                    hx::DFA::flags::COMPRESS_STATE_TABLE,
+                    input);
+}
+
+// Lexer like automata: every state has a default target and a few exceptions, which
+// is what COMPRESS_STATE_TABLE is meant for. Both tables are timed on the same
+// input; the per symbol ratio is what COMPRESSED_LOOKUP_COST in DFA.cpp stands for.
+void performance_sparse(const AutomataConfig &config, std::size_t exceptionsPerState) {
+    auto actions = config.actions;
+    std::default_random_engine randomness(config.states * 17 + exceptionsPerState);
+    std::uniform_int_distribution<std::size_t> state(0, config.states - 1);
+    std::uniform_int_distribution<std::size_t> action(0, actions - 1);
+
+    std::vector<std::size_t> transitions(config.states * actions);
+    for (std::size_t s = 0; s < config.states; ++s) {
+        std::fill_n(transitions.begin() + s * actions, actions, (s + 1) % config.states);
+        for (std::size_t e = 0; e < exceptionsPerState; ++e)
+            transitions[s * actions + action(randomness)] = state(randomness);
+    }
+    auto input = random_input(config);
+
+    hx::TransitionFunctionFunc source(
+        [&transitions, actions](std::size_t s, std::size_t a) {
+            return transitions[s * actions + a];
+        });
+    std::unique_ptr<hx::TransitionFunction> dense(
+        hx::DFACompileToDynamicTable(&source, config.states, actions));
+    std::unique_ptr<hx::TransitionFunction> compressed(
+        hx::DFACompileToCompressedTable(&source, config.states, actions));
+
+    std::cout << "== sparse states: " << config.states << ", actions: " << actions
+              << ", exceptions per state: " << exceptionsPerState << std::endl;
+
+    double nanoseconds[2];
+    hx::TransitionFunction *tables[] = {dense.get(), compressed.get()};
+    for (int t = 0; t < 2; ++t) {
+        START_MEASURE(t ? "  compressed" : "  dense");
+        const auto *symbols = input.data();
+        auto finalState = tables[t]->process(0, symbols, symbols + input.size());
+        STOP_MEASURE();
+
+        nanoseconds[t] = elapsed.count();
+        std::cout << "    table memory: " << tables[t]->memorySize() / 1024.0
+                  << " KiB, throughput: " << input.size() * 1000.0 / elapsed.count()
+                  << " Msymbols/s (final state " << finalState << ")" << std::endl;
+    }
+    std::cout << "  compressed / dense time per symbol: "
+              << nanoseconds[1] / nanoseconds[0] << std::endl;
+}
+
+int main() {
+    // dense tables from L1 resident (16 x 256) up to DRAM resident (65536 x 256)
+    std::vector<AutomataConfig> configs = {{16, 2, 1 << 12},
+                                           {16, 256, 1 << 24},
+                                           {1024, 2, 1 << 24},
+                                           {1024, 16, 1 << 24},
+                                           {1024, 256, 1 << 24},
+                                           {65536, 16, 1 << 24},
+                                           {65536, 256, 1 << 12},
+                                           {65536, 256, 1 << 24}};
+
+    for (const auto &config : configs)
+        performance_config(config);
+
+    // dense tables of 2 MiB, 32 MiB and 128 MiB
+    for (std::size_t states : {1024, 16384, 65536})
+        performance_sparse({states, 256, 1 << 24}, 4);
+}
\ No newline at end of file
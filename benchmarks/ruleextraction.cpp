@@ -0,0 +1,122 @@
+#include "ruleextraction/PointIndex.hpp"
+#include "ruleextraction/RuleSolution.hpp"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "benchmark.hpp"
+
+namespace {
+constexpr std::size_t DIMS = 4;
+constexpr std::size_t STRIDE = 8;
+constexpr std::size_t POINTS = 100000;
+constexpr std::size_t RULES = 200;
+constexpr std::size_t CLASSES = 4;
+
+struct Problem {
+    Problem()
+        : ruleCentres(RULES * STRIDE * sizeof(float))
+        , controlPoints(POINTS * STRIDE * sizeof(float))
+        , ruleClasses(RULES)
+        , controlClasses(POINTS)
+        , entropy(17) {
+        std::uniform_real_distribution<float> coordinate(-3.0f, 3.0f);
+        for (std::size_t i = 0; i < RULES; ++i) {
+            ruleClasses[i] = i % CLASSES;
+            for (std::size_t d = 0; d < DIMS; ++d)
+                ruleCentres.get_as<float>()[i * STRIDE + d] = coordinate(entropy);
+        }
+        for (std::size_t i = 0; i < POINTS; ++i) {
+            controlClasses[i] = i % CLASSES;
+            for (std::size_t d = 0; d < DIMS; ++d)
+                controlPoints.get_as<float>()[i * STRIDE + d] = coordinate(entropy);
+        }
+        index.build(controlPoints.get_as<float>(), POINTS, DIMS, STRIDE);
+    }
+
+    hx::ruleextraction::RuleSolution solution(hx::ruleextraction::ScoringEngine engine,
+                                              bool indexed) {
+        // the same boxes and moves for every engine, so the checksums agree
+        entropy.seed(23);
+        hx::ruleextraction::RuleSolution result(DIMS,
+                                                STRIDE,
+                                                &ruleCentres,
+                                                &controlPoints,
+                                                controlClasses,
+                                                ruleClasses,
+                                                entropy,
+                                                nullptr,
+                                                indexed ? &index : nullptr);
+        result.setScoringEngine(engine);
+        return result;
+    }
+
+    hx::memory::Storage ruleCentres;
+    hx::memory::Storage controlPoints;
+    std::vector<std::size_t> ruleClasses;
+    std::vector<std::size_t> controlClasses;
+    std::default_random_engine entropy;
+    hx::ruleextraction::PointIndex index;
+};
+
+// every box rewritten, as after a crossover
+void performance_full_scoring(Problem &problem,
+                              const char *name,
+                              hx::ruleextraction::ScoringEngine engine,
+                              bool indexed) {
+    auto solution = problem.solution(engine, indexed);
+    std::size_t score = 0;
+
+    START_MEASURE(name);
+    for (int i = 0; i < 10; ++i) {
+        solution.getData();
+        solution.invalidateScore();
+        score += solution.getScore();
+    }
+    STOP_MEASURE();
+    std::cout << "    checksum " << score << std::endl;
+}
+
+// single moves, half of them rejected, as in an annealing chain
+void performance_moves(Problem &problem,
+                       const char *name,
+                       hx::ruleextraction::ScoringEngine engine,
+                       bool indexed) {
+    auto solution = problem.solution(engine, indexed);
+    solution.getScore();
+    std::size_t score = 0;
+
+    START_MEASURE(name);
+    for (int i = 0; i < 2000; ++i) {
+        solution.propose();
+        score += solution.getScore();
+        if (i % 2)
+            solution.accept();
+        else
+            solution.reject();
+    }
+    STOP_MEASURE();
+    std::cout << "    checksum " << score << std::endl;
+}
+}// namespace
+
+int main() {
+    using hx::ruleextraction::ScoringEngine;
+    Problem problem;
+
+    performance_full_scoring(
+        problem, "Full scoring - coverage, scan", ScoringEngine::COVERAGE, false);
+    performance_full_scoring(
+        problem, "Full scoring - coverage, k-d tree", ScoringEngine::COVERAGE, true);
+    performance_full_scoring(
+        problem, "Full scoring - bitset, scan", ScoringEngine::BITSET, false);
+    performance_full_scoring(
+        problem, "Full scoring - bitset, k-d tree", ScoringEngine::BITSET, true);
+
+    performance_moves(problem, "Moves - coverage, scan", ScoringEngine::COVERAGE, false);
+    performance_moves(
+        problem, "Moves - coverage, k-d tree", ScoringEngine::COVERAGE, true);
+    performance_moves(problem, "Moves - bitset, scan", ScoringEngine::BITSET, false);
+    performance_moves(problem, "Moves - bitset, k-d tree", ScoringEngine::BITSET, true);
+    return 0;
+}
\ No newline at end of file
@@ -226,7 +226,7 @@ public:
                 std::forward<Function>(f),
                 std::forward<Args>(args)...);
         _taskQueue.push(std::move(task));
-        _threadBarrierVar.notify_one();
+        _WakeWorkers(false);
         return result_future;
     }
 
@@ -265,7 +265,7 @@ public:
         }
 
         _taskQueue.push_many(task_to_process.begin(), task_to_process.end());
-        _threadBarrierVar.notify_all();
+        _WakeWorkers(true);
 
         return std::async(
             std::launch::deferred,
@@ -281,6 +281,17 @@ public:
     }
 
 private:
+    // Taking the barrier lock orders the push before a worker about to sleep checks
+    // the queue, otherwise the notification could be lost and the task left waiting
+    // for the next one
+    void _WakeWorkers(bool all) {
+        { std::lock_guard lock(_threadBarrierSync); }
+        if (all)
+            _threadBarrierVar.notify_all();
+        else
+            _threadBarrierVar.notify_one();
+    }
+
     void _ThreadRoutine() noexcept {
         while (_DispatchTask()) {
             typename TaskQueue::value_type task;
@@ -1,13 +1,47 @@
 #pragma once
 
+#include <limits>
 #include <numeric>
+#include <optional>
 #include <queue>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
+#include "ThreadPool.hpp"
 #include "automata/TransitionFunction.hpp"
 
 namespace hx {
 
+// Visit statistics gathered by DFA::profile on sample input
+class DFAProfile {
+public:
+    DFAProfile(std::size_t numberOfStates) : _visitHistogram(numberOfStates, 0) {}
+
+    void recordVisit(std::size_t state) { ++_visitHistogram[state]; }
+    void recordTransition(std::size_t state, std::size_t action) {
+        ++_transitionCounts[std::make_pair(state, action)];
+    }
+
+    const std::vector<std::size_t> &getVisitHistogram() const { return _visitHistogram; }
+    const hx::TransitionFunctionMap::ContainerMap &getTransitionCounts() const {
+        return _transitionCounts;
+    }
+
+private:
+    std::vector<std::size_t> _visitHistogram;
+    hx::TransitionFunctionMap::ContainerMap _transitionCounts;
+};
+
+std::vector<char> DFAAccessibleStates(hx::TransitionFunction *,
+                                      std::size_t,
+                                      std::size_t,
+                                      std::size_t);
+hx::TransitionFunction *DFACompileToMinimalTable(hx::TransitionFunction *,
+                                                 std::size_t,
+                                                 std::size_t,
+                                                 std::size_t,
+                                                 const std::vector<char> &);
 hx::TransitionFunction *DFACompileToDynamicTable(hx::TransitionFunction *,
                                                  std::size_t,
                                                  std::size_t);
@@ -15,12 +49,117 @@ hx::TransitionFunction *DFACompileToReducedTable(hx::TransitionFunction *,
                                                  std::size_t,
                                                  std::size_t,
                                                  std::size_t);
+hx::TransitionFunction *DFACompileToShuffleTable(hx::TransitionFunction *,
+                                                 std::size_t,
+                                                 std::size_t,
+                                                 std::size_t);
+hx::TransitionFunction *DFACompileToCompressedTable(
+    hx::TransitionFunction *,
+    std::size_t,
+    std::size_t,
+    std::size_t = std::numeric_limits<std::size_t>::max());
+hx::TransitionFunction *DFACompileToCompactTable(hx::TransitionFunction *,
+                                                 std::size_t,
+                                                 std::size_t);
+std::vector<std::size_t> DFAProfiledStateOrder(hx::TransitionFunction *,
+                                               std::size_t,
+                                               const hx::DFAProfile &,
+                                               const std::vector<char> * = nullptr);
+hx::TransitionFunction *DFACompileToProfiledTable(
+    hx::TransitionFunction *,
+    std::size_t,
+    std::size_t,
+    const hx::DFAProfile &,
+    std::size_t = std::numeric_limits<std::size_t>::max());
+
+template <typename InputIt1, typename InputIt2>
+std::size_t DFARunSequence(const hx::TransitionFunction &transitionFunction,
+                           std::size_t state,
+                           InputIt1 begin,
+                           InputIt2 end) {
+    if constexpr (std::is_pointer_v<InputIt1> && std::is_same_v<InputIt1, InputIt2>
+                  && std::is_same_v<std::remove_cv_t<std::remove_pointer_t<InputIt1>>,
+                                    std::uint8_t>) {
+        return transitionFunction.process(state, begin, end);
+    } else {
+        while (begin != end)
+            state = transitionFunction.get(state, *(begin++));
+        return state;
+    }
+}
+
+// Position inside a DFA. The cursor owns only the current state and borrows the
+// transition table and final states, so any number of cursors may run one DFA
+// concurrently. Cursors are invalidated by DFA::compile.
+class DFACursor {
+public:
+    std::size_t process(std::size_t action) {
+        _currentState = this->peek(action);
+        return _currentState;
+    }
+
+    template <typename InputIt1, typename InputIt2>
+    std::size_t process(InputIt1 begin, InputIt2 end) {
+        _currentState = DFARunSequence(*_transitionFunction, _currentState, begin, end);
+        return _currentState;
+    }
 
+    bool isFinal() const { return _finalStates[_currentState]; }
+    bool peekFinal(std::size_t action) const { return _finalStates[peek(action)]; }
+
+    std::size_t peek(std::size_t action) const {
+        return _transitionFunction->get(_currentState, action);
+    }
+
+    std::size_t getState() const { return _currentState; }
+    void reset() { _currentState = _startingState; }
+
+private:
+    friend class DFA;
+
+    DFACursor() = default;
+    DFACursor(const hx::TransitionFunction *transitionFunction,
+              const char *finalStates,
+              std::size_t startingState)
+        : _transitionFunction(transitionFunction)
+        , _finalStates(finalStates)
+        , _startingState(startingState)
+        , _currentState(startingState) {}
+
+    const hx::TransitionFunction *_transitionFunction = nullptr;
+    const char *_finalStates = nullptr;
+    std::size_t _startingState = 0;
+    std::size_t _currentState = 0;
+};
+
+enum class DFAProductType : std::uint8_t { INTERSECTION, UNION, DIFFERENCE };
+
+inline bool DFAProductAccepts(DFAProductType type, bool a, bool b) {
+    switch (type) {
+        case DFAProductType::INTERSECTION:
+            return a && b;
+        case DFAProductType::UNION:
+            return a || b;
+        case DFAProductType::DIFFERENCE:
+            return a && !b;
+    }
+    return false;
+}
+
+// Compiled automaton. All const members are thread safe; process, peek, isFinal
+// and reset drive one embedded cursor for single threaded use, concurrent users
+// should take their own with cursor().
 class DFA {
 public:
     struct flags {
         constexpr static std::uint8_t REDUCE_STATE_TABLE = 1 << 1;
         constexpr static std::uint8_t CREATE_DYNAMIC_TABLE = 1 << 2;
+        // dense or compressed table, whichever is cheaper for the automaton size
+        constexpr static std::uint8_t COMPRESS_STATE_TABLE = 1 << 3;
+        // renumber states by the profile collected with DFA::profile
+        constexpr static std::uint8_t PROFILE_GUIDED_LAYOUT = 1 << 4;
+        // merge equivalent states (Moore partition refinement)
+        constexpr static std::uint8_t MINIMISE_STATE_TABLE = 1 << 5;
     };
 
     constexpr static std::size_t INVALID_STATE = std::numeric_limits<std::size_t>::max();
@@ -29,7 +168,6 @@ public:
         std::size_t startingState,
         const std::vector<std::size_t> &finalStates)
         : _startingState(startingState)
-        , _currentState(startingState)
         , _numberOfStates(0)
         , _numberOfActions(0) {
         _transitionFunction =
@@ -44,6 +182,7 @@ public:
         _numberOfActions += 1;
 
         _createFinalStates(finalStates.cbegin(), finalStates.cend());
+        _cursor = cursor();
     }
 
     DFA(std::function<std::size_t(std::size_t, std::size_t)> stateTransitionMap,
@@ -52,60 +191,206 @@ public:
         std::size_t numberOfStates,
         std::size_t numberOfActions)
         : _startingState(_startingState)
-        , _currentState(_startingState)
         , _numberOfStates(numberOfStates)
         , _numberOfActions(numberOfActions) {
         _transitionFunction =
             std::make_unique<TransitionFunctionFunc>(stateTransitionMap);
 
         _createFinalStates(finalStates.cbegin(), finalStates.cend());
+        _cursor = cursor();
     }
 
-    std::size_t process(std::size_t action) {
-        _currentState = this->peek(action);
-        return _currentState;
+    DFA(std::unique_ptr<hx::TransitionFunction> transitionFunction,
+        std::size_t startingState,
+        const std::vector<std::size_t> &finalStates,
+        std::size_t numberOfStates,
+        std::size_t numberOfActions)
+        : _transitionFunction(std::move(transitionFunction))
+        , _startingState(startingState)
+        , _numberOfStates(numberOfStates)
+        , _numberOfActions(numberOfActions) {
+        _createFinalStates(finalStates.cbegin(), finalStates.cend());
+        _cursor = cursor();
+    }
+
+    // Product automaton built from the state pairs reachable from the two starting
+    // states, throws std::length_error when it needs more than `stateBudget` states.
+    // DFAProductCursor runs the same product lazily without building anything.
+    static DFA product(const DFA &a,
+                       const DFA &b,
+                       DFAProductType type,
+                       std::size_t stateBudget = DEFAULT_PRODUCT_BUDGET);
+
+    hx::DFACursor cursor() const {
+        return hx::DFACursor(
+            _transitionFunction.get(), _finalStates.data(), _startingState);
     }
 
+    std::size_t process(std::size_t action) { return _cursor.process(action); }
+
     template <typename InputIt1, typename InputIt2>
     std::size_t process(InputIt1 begin, InputIt2 end) {
-        while (begin != end)
-            process(*(begin++));
-        return _currentState;
+        return _cursor.process(begin, end);
     }
 
-    bool isFinal() const { return _finalStates[_currentState]; }
-    bool peekFinal(std::size_t action) const { return _finalStates[peek(action)]; }
+    // Same as process, but starts from `state` and leaves the current state untouched
+    template <typename InputIt1, typename InputIt2>
+    std::size_t run(std::size_t state, InputIt1 begin, InputIt2 end) const {
+        return DFARunSequence(*_transitionFunction, state, begin, end);
+    }
 
-    std::size_t peek(std::size_t action) const {
-        return _transitionFunction->get(_currentState, action);
+    // Instrumented run from the starting state, visits and transitions are added
+    // to the profile used by PROFILE_GUIDED_LAYOUT
+    template <typename InputIt1, typename InputIt2>
+    std::size_t profile(InputIt1 begin, InputIt2 end) {
+        if (!_profile) _profile.emplace(_numberOfStates);
+
+        std::size_t state = _startingState;
+        _profile->recordVisit(state);
+        while (begin != end) {
+            auto action = *(begin++);
+            _profile->recordTransition(state, action);
+
+            state = _transitionFunction->get(state, action);
+            if (state >= _numberOfStates) break;
+            _profile->recordVisit(state);
+        }
+        return state;
     }
 
-    void reset() { _currentState = _startingState; }
+    const hx::DFAProfile *getProfile() const { return _profile ? &*_profile : nullptr; }
+    void resetProfile() { _profile.reset(); }
+
+    std::size_t transition(std::size_t state, std::size_t action) const {
+        return _transitionFunction->get(state, action);
+    }
+
+    // Runs every sequence [symbols + offsets[i], symbols + offsets[i + 1]) from the
+    // starting state. Sequences are split into chunks that are processed by the pool
+    // workers, results go to preallocated arrays (either may be nullptr). Returns the
+    // number of accepted sequences.
+    template <typename T, typename TaskQueue>
+    std::size_t processBatch(const T *symbols,
+                             const std::size_t *offsets,
+                             std::size_t numberOfSequences,
+                             std::size_t *finalStates,
+                             char *accepted,
+                             hx::ThreadPool<TaskQueue> &threadPool,
+                             std::size_t chunkSize = 0) const {
+        if (chunkSize == 0)
+            chunkSize = std::max<std::size_t>(
+                1, numberOfSequences / (BATCH_CHUNKS_PER_WORKER * threadPool.size()));
+
+        auto processChunk = [=](std::size_t first, std::size_t last) -> std::size_t {
+            std::size_t acceptedCount = 0;
+            for (std::size_t i = first; i < last; ++i) {
+                auto state =
+                    run(_startingState, symbols + offsets[i], symbols + offsets[i + 1]);
+                bool isAccepted = state < _numberOfStates && _finalStates[state];
+
+                if (finalStates) finalStates[i] = state;
+                if (accepted) accepted[i] = isAccepted;
+                acceptedCount += isAccepted;
+            }
+            return acceptedCount;
+        };
+
+        std::vector<std::future<std::size_t>> chunks;
+        chunks.reserve(1 + numberOfSequences / chunkSize);
+        for (std::size_t first = 0; first < numberOfSequences; first += chunkSize) {
+            chunks.push_back(threadPool.async_task(
+                processChunk, first, std::min(first + chunkSize, numberOfSequences)));
+        }
+
+        std::size_t acceptedCount = 0;
+        for (auto &chunk : chunks)
+            acceptedCount += chunk.get();
+        return acceptedCount;
+    }
+
+    bool isFinal() const { return _cursor.isFinal(); }
+    bool peekFinal(std::size_t action) const { return _cursor.peekFinal(action); }
+
+    std::size_t peek(std::size_t action) const { return _cursor.peek(action); }
+
+    bool isFinalState(std::size_t state) const { return _finalStates[state]; }
+
+    std::size_t getStartingState() const { return _startingState; }
+    std::size_t getNumberOfStates() const { return _numberOfStates; }
+    std::size_t getNumberOfActions() const { return _numberOfActions; }
+    const hx::TransitionFunction &getTransitionFunction() const {
+        return *_transitionFunction;
+    }
+
+    void reset() { _cursor.reset(); }
     void compile(std::uint8_t flags) {
         hx::TransitionFunction *newTransitionFunction = _transitionFunction.get();
+        std::unique_ptr<hx::TransitionFunction> compiled;
+
+        // every stage copies what it needs, so the previous stage can be released
+        auto advance = [&](hx::TransitionFunction *stage) {
+            if (stage == nullptr || stage == newTransitionFunction) return;
+            compiled.reset(stage);
+            newTransitionFunction = stage;
+        };
 
         if (flags & DFA::flags::CREATE_DYNAMIC_TABLE)
-            newTransitionFunction = DFACompileToDynamicTable(
-                newTransitionFunction, _numberOfStates, _numberOfActions);
+            advance(DFACompileToDynamicTable(
+                newTransitionFunction, _numberOfStates, _numberOfActions));
+
+        const bool minimised = flags & DFA::flags::MINIMISE_STATE_TABLE;
+        if (minimised)
+            advance(DFACompileToMinimalTable(newTransitionFunction,
+                                             _numberOfStates,
+                                             _numberOfActions,
+                                             _startingState,
+                                             _finalStates));
 
-        if (flags & DFA::flags::REDUCE_STATE_TABLE)
-            newTransitionFunction = DFACompileToReducedTable(
+        // up to 16 reachable states fit into a single pshufb permutation. Minimised
+        // tables already drop the unreachable states of larger ones, and profiled
+        // tables drop them as part of the layout when a reduction is asked for.
+        const bool profiled = (flags & DFA::flags::PROFILE_GUIDED_LAYOUT) && _profile;
+        const bool reduce = flags & DFA::flags::REDUCE_STATE_TABLE;
+        if (reduce) {
+            auto reduced = DFACompileToShuffleTable(
                 newTransitionFunction, _numberOfStates, _numberOfActions, _startingState);
+            if (!reduced && !profiled && !minimised)
+                reduced = DFACompileToReducedTable(newTransitionFunction,
+                                                   _numberOfStates,
+                                                   _numberOfActions,
+                                                   _startingState);
+            advance(reduced);
+        }
+
+        if (profiled)
+            advance(DFACompileToProfiledTable(newTransitionFunction,
+                                              _numberOfStates,
+                                              _numberOfActions,
+                                              *_profile,
+                                              reduce ? _startingState
+                                                     : DFA::INVALID_STATE));
 
-        if (newTransitionFunction != nullptr
-            && newTransitionFunction != _transitionFunction.get()) {
-            _transitionFunction.reset(newTransitionFunction);
-            reset();
+        if (flags & DFA::flags::COMPRESS_STATE_TABLE)
+            advance(DFACompileToCompactTable(
+                newTransitionFunction, _numberOfStates, _numberOfActions));
+
+        if (compiled) {
+            _transitionFunction = std::move(compiled);
+            _cursor = cursor();
         }
     }
 
 private:
+    constexpr static std::size_t BATCH_CHUNKS_PER_WORKER = 8;
+    constexpr static std::size_t DEFAULT_PRODUCT_BUDGET = 1 << 20;
+
     std::unique_ptr<hx::TransitionFunction> _transitionFunction;
     std::size_t _startingState;
-    std::size_t _currentState;
     std::vector<char> _finalStates;
+    hx::DFACursor _cursor;
     std::size_t _numberOfStates;
     std::size_t _numberOfActions;
+    std::optional<hx::DFAProfile> _profile;
 
     void _createFinalStates(std::vector<std::size_t>::const_iterator begin,
                             std::vector<std::size_t>::const_iterator end) {
@@ -116,4 +401,59 @@ private:
             _finalStates[*begin++] = 1;
     }
 };
+
+// Lazy product of two DFAs, steps both automata side by side. A side that runs
+// into an undefined transition stays rejecting for the rest of the input.
+class DFAProductCursor {
+public:
+    DFAProductCursor(const DFA &a, const DFA &b, DFAProductType type)
+        : _a(&a), _b(&b), _type(type) {
+        reset();
+    }
+
+    void process(std::size_t action) {
+        _stateA = _step(*_a, _stateA, action);
+        _stateB = _step(*_b, _stateB, action);
+    }
+
+    template <typename InputIt1, typename InputIt2>
+    void process(InputIt1 begin, InputIt2 end) {
+        while (begin != end)
+            process(*(begin++));
+    }
+
+    bool isFinal() const {
+        return DFAProductAccepts(_type, _isFinal(*_a, _stateA), _isFinal(*_b, _stateB));
+    }
+
+    std::pair<std::size_t, std::size_t> getState() const {
+        return std::make_pair(_stateA, _stateB);
+    }
+
+    void reset() {
+        _stateA = _a->getStartingState();
+        _stateB = _b->getStartingState();
+    }
+
+private:
+    static std::size_t _step(const DFA &dfa, std::size_t state, std::size_t action) {
+        if (state >= dfa.getNumberOfStates() || action >= dfa.getNumberOfActions())
+            return DFA::INVALID_STATE;
+        try {
+            return dfa.transition(state, action);
+        } catch (std::out_of_range &) {
+            return DFA::INVALID_STATE;
+        }
+    }
+
+    static bool _isFinal(const DFA &dfa, std::size_t state) {
+        return state < dfa.getNumberOfStates() && dfa.isFinalState(state);
+    }
+
+    const DFA *_a;
+    const DFA *_b;
+    DFAProductType _type;
+    std::size_t _stateA;
+    std::size_t _stateB;
+};
 }// namespace hx
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "automata/DFA.hpp"
+
+namespace hx {
+
+// Byte oriented scanner over a DFA. Reports every input offset after which the
+// automaton is in a final state. States that self-loop on all but a few symbols
+// are "accelerated": the scanner jumps straight to the next escaping symbol with
+// a vectorised byte search instead of stepping through the table.
+class DFAScanner {
+public:
+    constexpr static std::size_t ALPHABET_SIZE = 256;
+    constexpr static std::size_t MAX_ESCAPE_SYMBOLS = 3;
+
+    explicit DFAScanner(const hx::DFA &dfa);
+
+    // Appends accept offsets to `offsets`, returns the state after the last
+    // symbol or DFA::INVALID_STATE if the automaton got stuck.
+    std::size_t scan(const std::uint8_t *begin,
+                     const std::uint8_t *end,
+                     std::vector<std::size_t> &offsets) const;
+
+    std::vector<std::size_t> scan(const std::uint8_t *begin,
+                                  const std::uint8_t *end) const {
+        std::vector<std::size_t> offsets;
+        scan(begin, end, offsets);
+        return offsets;
+    }
+
+    bool isAccelerated(std::size_t state) const;
+    std::size_t getNumberOfStates() const { return _externalStates.size(); }
+
+private:
+    struct Acceleration {
+        std::uint8_t count;
+        std::array<std::uint8_t, MAX_ESCAPE_SYMBOLS> symbols;
+    };
+
+    constexpr static std::uint8_t NOT_ACCELERATED = 0xff;
+
+    void _createAcceleration();
+
+    std::vector<std::uint32_t> _table;
+    std::vector<char> _finalStates;
+    std::vector<Acceleration> _acceleration;
+    std::vector<std::size_t> _externalStates;
+    std::vector<std::uint32_t> _internalStates;
+    std::uint32_t _startingState;
+    std::uint32_t _deadState;
+};
+}// namespace hx
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "automata/TransitionFunction.hpp"
+
+namespace hx {
+
+// Bit parallel NFA simulation. The automaton is converted into its homogeneous
+// (Glushkov) form, where all transitions entering a position share one symbol, so
+// a step is D' = Follow(D) & B[action]. Follow(D) is looked up byte by byte from
+// precomputed tables, sequence patterns use a plain Shift-And shift instead.
+class NFA {
+public:
+    using ContainerMap = std::unordered_map<std::pair<std::size_t, std::size_t>,
+                                            std::vector<std::size_t>,
+                                            TransitionFunctionMap::pair_hash>;
+    using StateSet = std::uint64_t;
+
+    constexpr static std::size_t MAX_POSITIONS = 64;
+
+    NFA(const ContainerMap &stateTransitionMap,
+        const std::vector<std::size_t> &startingStates,
+        const std::vector<std::size_t> &finalStates);
+
+    // Shift-And automaton for a sequence of symbol classes, with `unanchored` set
+    // the pattern may start at any input position
+    static NFA fromSequence(const std::vector<std::vector<std::size_t>> &symbolClasses,
+                            bool unanchored = true);
+
+    StateSet process(std::size_t action) {
+        _currentState = this->peek(action);
+        return _currentState;
+    }
+
+    template <typename InputIt1, typename InputIt2>
+    StateSet process(InputIt1 begin, InputIt2 end) {
+        StateSet state = _currentState;
+        while (begin != end)
+            state = _step(state, *(begin++));
+        _currentState = state;
+        return _currentState;
+    }
+
+    bool isFinal() const { return _currentState & _finalStates; }
+    bool peekFinal(std::size_t action) const { return peek(action) & _finalStates; }
+
+    StateSet peek(std::size_t action) const { return _step(_currentState, action); }
+
+    void reset() { _currentState = _startingStates; }
+
+    std::size_t getNumberOfPositions() const { return _numberOfPositions; }
+    std::size_t getNumberOfActions() const { return _symbolMasks.size(); }
+
+private:
+    constexpr static std::size_t CHUNK_BITS = 8;
+    constexpr static std::size_t CHUNK_SIZE = 1 << CHUNK_BITS;
+
+    NFA() = default;
+
+    StateSet _step(StateSet state, std::size_t action) const {
+        const StateSet mask = action < _symbolMasks.size() ? _symbolMasks[action] : 0;
+
+        StateSet follow = 0;
+        if (_followTable.empty()) {
+            follow = state << 1;
+        } else {
+            for (const StateSet *chunk = _followTable.data(); state;
+                 state >>= CHUNK_BITS, chunk += CHUNK_SIZE)
+                follow |= chunk[state & (CHUNK_SIZE - 1)];
+        }
+
+        return (follow & mask) | _persistentStates;
+    }
+
+    std::vector<StateSet> _symbolMasks;
+    std::vector<StateSet> _followTable;
+    StateSet _startingStates = 0;
+    StateSet _finalStates = 0;
+    StateSet _persistentStates = 0;
+    StateSet _currentState = 0;
+    std::size_t _numberOfPositions = 0;
+};
+}// namespace hx
\ No newline at end of file
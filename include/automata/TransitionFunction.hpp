@@ -1,17 +1,25 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <type_traits>
 #include <unordered_map>
 
+#include "memory/MappedStorage.hpp"
 #include "memory/Storage.hpp"
 #include "memory/StorageView.hpp"
 #include "memory/Utils.hpp"
 
+#ifdef __SSSE3__
+#include <immintrin.h>
+#endif
+
 namespace hx {
 
-enum class TransitionType : std::uint8_t { MAP, FUNC, TABLE };
+enum class TransitionType : std::uint8_t { MAP, FUNC, TABLE, SHUFFLE, COMPRESSED };
 
 class TransitionFunction {
 public:
@@ -19,6 +27,19 @@ public:
     virtual TransitionType getType() const = 0;
     virtual ~TransitionFunction() = default;
 
+    // Bytes held by the transition data, 0 when it is not known
+    virtual std::size_t memorySize() const { return 0; }
+
+    // Runs a whole byte sequence at once, so implementations can keep the state in
+    // registers instead of going through get() for every symbol
+    virtual std::size_t process(std::size_t state,
+                                const std::uint8_t *begin,
+                                const std::uint8_t *end) const {
+        while (begin != end)
+            state = this->get(state, *begin++);
+        return state;
+    }
+
     std::size_t operator()(std::size_t state, std::size_t alphabet) const {
         return this->get(state, alphabet);
     }
@@ -29,7 +50,8 @@ public:
     TransitionFunctionTable(std::size_t numberOfStates, std::size_t numberOfActions)
         : _numberOfStates(numberOfStates)
         , _numberOfActions(numberOfActions)
-        , _tableStorage(sizeof(std::size_t) * _numberOfStates * _numberOfActions)
+        , _tableStorage(hx::memory::allocateStorage(sizeof(std::size_t) * _numberOfStates
+                                                    * _numberOfActions))
         , _tableView(&_tableStorage, _numberOfStates, _numberOfActions){};
 
     virtual ~TransitionFunctionTable() = default;
@@ -38,11 +60,22 @@ public:
         return _tableView(state, action);
     }
 
+    // stops at the first undefined transition, whose invalid state has no row
+    std::size_t process(std::size_t state,
+                        const std::uint8_t *begin,
+                        const std::uint8_t *end) const override {
+        const std::size_t *table = _tableView.data();
+        for (; begin != end && state < _numberOfStates; ++begin)
+            state = table[state * _numberOfActions + *begin];
+        return state;
+    }
+
     void set(std::size_t inputState, std::size_t inputAction, std::size_t outputState) {
         _tableView(inputState, inputAction) = outputState;
     }
 
     TransitionType getType() const override { return TransitionType::TABLE; }
+    std::size_t memorySize() const override { return _tableStorage.size(); }
 
 private:
     const std::size_t _numberOfStates;
@@ -57,26 +90,49 @@ public:
     TransitionFunctionTableIndirect(std::unique_ptr<TransitionFunction> base,
                                     hx::memory::SmallLookupBimap bimapStates,
                                     hx::memory::SmallLookupBimap bimapAction)
-        : _base(std::move(base)), _bimapStates(bimapStates), _bimapActions(bimapAction){};
+        : _base(std::move(base)), _bimapStates(bimapStates), _bimapActions(bimapAction) {
+        for (std::size_t i = 0; i < _bimapActions.size(); ++i)
+            _identityActions = _identityActions && _bimapActions.to(i) == i;
+    };
 
     std::size_t get(std::size_t state, std::size_t action) const override {
-        return _bimapStates.from(
-            _base->get(_bimapStates.to(state), _bimapActions.to(action)));
+        auto transform = _base->get(_bimapStates.to(state), _bimapActions.to(action));
+        return transform < _bimapStates.size() ? _bimapStates.from(transform)
+                                               : transform;
+    }
+
+    // The state is translated once each way, the base table runs the whole sequence
+    // on its own dense ids
+    std::size_t process(std::size_t state,
+                        const std::uint8_t *begin,
+                        const std::uint8_t *end) const override {
+        if (begin == end) return state;
+        if (!_identityActions) return TransitionFunction::process(state, begin, end);
+
+        auto transform = _base->process(_bimapStates.to(state), begin, end);
+        return transform < _bimapStates.size() ? _bimapStates.from(transform)
+                                               : transform;
     }
 
     TransitionType getType() const override { return _base->getType(); }
+    std::size_t memorySize() const override {
+        return _base->memorySize()
+               + sizeof(std::size_t) * 2 * (_bimapStates.size() + _bimapActions.size());
+    }
 
 private:
     std::unique_ptr<TransitionFunction> _base;
     hx::memory::SmallLookupBimap _bimapStates;
     hx::memory::SmallLookupBimap _bimapActions;
+    bool _identityActions = true;
 };
 
 class TransitionFunctionMap : public TransitionFunction {
 public:
     struct pair_hash {
         std::size_t operator()(const std::pair<std::size_t, std::size_t> &p) const {
-            return std::hash<std::size_t>()(p.first ^ p.second);
+            // plain xor sends every (x, x) pair, common in product automata, to 0
+            return std::hash<std::size_t>()(p.first * 0x9e3779b97f4a7c15ul ^ p.second);
         }
     };
 
@@ -108,4 +164,114 @@ public:
 private:
     FunctionType f;
 };
+
+// Automata with at most 16 states keep the whole transition of a symbol as a state
+// permutation in one 16 byte vector, so each step is a single pshufb
+class TransitionFunctionShuffle : public TransitionFunction {
+public:
+    constexpr static std::size_t MAX_STATES = 16;
+    constexpr static std::size_t ALPHABET_SIZE = 256;
+
+    TransitionFunctionShuffle(hx::memory::SmallLookupBimap bimapStates)
+        : _shuffleTable(ALPHABET_SIZE), _bimapStates(std::move(bimapStates)) {
+        // undefined transitions go to a sink lane, which maps back to an invalid state
+        for (auto &permutation : _shuffleTable)
+            permutation.next.fill(DEAD_STATE);
+    }
+
+    std::size_t get(std::size_t state, std::size_t action) const override {
+        return _toExternal(_shuffleTable[action].next[_bimapStates.to(state)]);
+    }
+
+    std::size_t process(std::size_t state,
+                        const std::uint8_t *begin,
+                        const std::uint8_t *end) const override {
+        std::uint8_t current = static_cast<std::uint8_t>(_bimapStates.to(state));
+#ifdef __SSSE3__
+        __m128i vectorState = _mm_set1_epi8(static_cast<char>(current));
+        for (; begin != end; ++begin) {
+            vectorState = _mm_shuffle_epi8(
+                _mm_load_si128(
+                    reinterpret_cast<const __m128i *>(_shuffleTable[*begin].next.data())),
+                vectorState);
+        }
+        current = static_cast<std::uint8_t>(_mm_cvtsi128_si32(vectorState));
+#else
+        for (; begin != end; ++begin)
+            current = _shuffleTable[*begin].next[current];
+#endif
+        return _toExternal(current);
+    }
+
+    void set(std::size_t inputState, std::size_t inputAction, std::size_t outputState) {
+        _shuffleTable[inputAction].next[inputState] =
+            static_cast<std::uint8_t>(outputState);
+    }
+
+    TransitionType getType() const override { return TransitionType::SHUFFLE; }
+    std::size_t memorySize() const override {
+        return sizeof(Permutation) * _shuffleTable.size();
+    }
+
+private:
+    constexpr static std::uint8_t DEAD_STATE = MAX_STATES - 1;
+
+    struct alignas(16) Permutation {
+        std::array<std::uint8_t, MAX_STATES> next;
+    };
+
+    std::size_t _toExternal(std::uint8_t state) const {
+        return state < _bimapStates.size() ? _bimapStates.from(state)
+                                           : std::numeric_limits<std::size_t>::max();
+    }
+
+    std::vector<Permutation> _shuffleTable;
+    hx::memory::SmallLookupBimap _bimapStates;
+};
+
+// Sparse table for large automata. Identical rows are stored once, each row keeps
+// the most common target as its default and only the exceptions are packed into
+// shared comb arrays: an exception of `row` for `action` lives at bases[row] + action
+// and is recognised by check[bases[row] + action] == row.
+class TransitionFunctionTableCompressed : public TransitionFunction {
+public:
+    constexpr static std::uint32_t INVALID_STATE = std::numeric_limits<std::uint32_t>::max();
+
+    TransitionFunctionTableCompressed(std::vector<std::uint32_t> rowOfState,
+                                      std::vector<std::uint32_t> defaults,
+                                      std::vector<std::uint32_t> bases,
+                                      std::vector<std::uint32_t> next,
+                                      std::vector<std::uint32_t> check)
+        : _rowOfState(std::move(rowOfState))
+        , _defaults(std::move(defaults))
+        , _bases(std::move(bases))
+        , _next(std::move(next))
+        , _check(std::move(check)){};
+
+    std::size_t get(std::size_t state, std::size_t action) const override {
+        const auto row = _rowOfState[state];
+        const auto index = _bases[row] + action;
+        const auto transform = index < _check.size() && _check[index] == row
+                                   ? _next[index]
+                                   : _defaults[row];
+        return transform == INVALID_STATE ? std::numeric_limits<std::size_t>::max()
+                                          : transform;
+    }
+
+    TransitionType getType() const override { return TransitionType::COMPRESSED; }
+    std::size_t memorySize() const override {
+        return sizeof(std::uint32_t)
+               * (_rowOfState.size() + _defaults.size() + _bases.size() + _next.size()
+                  + _check.size());
+    }
+
+    std::size_t getNumberOfRows() const { return _defaults.size(); }
+
+private:
+    std::vector<std::uint32_t> _rowOfState;
+    std::vector<std::uint32_t> _defaults;
+    std::vector<std::uint32_t> _bases;
+    std::vector<std::uint32_t> _next;
+    std::vector<std::uint32_t> _check;
+};
 }// namespace hx
\ No newline at end of file
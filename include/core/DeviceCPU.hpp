@@ -2,16 +2,35 @@
 
 #include <boost/align/aligned_allocator.hpp>
 #include "core/Device.hpp"
+#include "core/Stream.hpp"
+#include "memory/AllocationTracker.hpp"
+#include "memory/MappedStorage.hpp"
+#include "memory/NumaStorage.hpp"
 #include "memory/Storage.hpp"
 
 #include "ThreadPool.hpp"
 
 namespace hx {
+enum class StorageHint : uint8_t {
+    NONE,
+    // aligned for vector loads
+    FAST,
+    // explicit huge pages whatever the size, with the transparent ones as fallback
+    HUGE_PAGES,
+    // never a mapping, e.g. for buffers reallocated often
+    SMALL_PAGES
+};
+
+using StreamCPU = hx::Stream<hx::ThreadPool<>>;
+
 class DeviceCPU : public hx::Device {
 public:
     hx::DeviceType getType() const override { return hx::DeviceType::CPU; }
     hx::ThreadPool<> &getDefaultThreadPool() { return _defaultThreadPool; }
 
+    // ordered work queue on the default pool, has to be destroyed before the device
+    StreamCPU createStream() { return StreamCPU(_defaultThreadPool); }
+
     template <typename T>
     auto getDefaultAllocator() const {
         return std::allocator<T>();
@@ -22,15 +41,77 @@ public:
         return boost::alignment::aligned_allocator<T, 32>();
     }
 
+    // Every storage handed out is counted in getAllocationTracker(), under `tag`
+    // for the overloads taking one
+
     hx::memory::Storage getStorage(std::size_t size_in_bytes, bool fast = false) const {
-        if (fast) {
-            return hx::memory::Storage(size_in_bytes, getSpecialAllocator<std::size_t>());
+        return getStorage(size_in_bytes, fast ? StorageHint::FAST : StorageHint::NONE);
+    }
+
+    // large buffers are anonymous mappings on transparent huge pages, they are page
+    // aligned so also satisfy FAST
+    hx::memory::Storage getStorage(
+        std::size_t size_in_bytes,
+        StorageHint hint,
+        const std::string &tag = hx::memory::AllocationTracker::UNTAGGED) const {
+        if (hint == StorageHint::HUGE_PAGES)
+            return this->tracked(hx::memory::mapAnonymous(
+                                     size_in_bytes, hx::memory::PageMode::EXPLICIT_HUGE),
+                                 tag);
+        if (hint != StorageHint::SMALL_PAGES
+            && size_in_bytes >= hx::memory::HUGE_PAGE_THRESHOLD)
+            return this->tracked(
+                hx::memory::mapAnonymous(size_in_bytes,
+                                         hx::memory::PageMode::TRANSPARENT_HUGE),
+                tag);
+
+        if (hint == StorageHint::FAST) {
+            return this->tracked(
+                hx::memory::Storage(size_in_bytes, getSpecialAllocator<std::size_t>()),
+                tag);
         } else {
-            return hx::memory::Storage(size_in_bytes, getDefaultAllocator<std::size_t>());
+            return this->tracked(
+                hx::memory::Storage(size_in_bytes, getDefaultAllocator<std::size_t>()),
+                tag);
         }
     }
 
+    hx::memory::Storage getStorage(
+        std::size_t size_in_bytes,
+        hx::memory::NumaPolicy policy,
+        std::size_t node = 0,
+        const std::string &tag = hx::memory::AllocationTracker::UNTAGGED) const {
+        return this->tracked(hx::memory::mapNuma(size_in_bytes, policy, node), tag);
+    }
+
+    // first touch from the default pool, whose workers later process the data
+    template <typename T, typename Function>
+    void firstTouch(hx::memory::Storage &storage, Function initialise) {
+        hx::memory::parallelFirstTouch<T>(storage, _defaultThreadPool, initialise);
+    }
+
+    // storage drawn from an arena or pool, aligned like the fast storage
+    hx::memory::Storage getStorage(
+        std::size_t size_in_bytes,
+        std::pmr::memory_resource *resource,
+        const std::string &tag = hx::memory::AllocationTracker::UNTAGGED) const {
+        return this->tracked(hx::memory::Storage(size_in_bytes, resource, 32), tag);
+    }
+
+    // live, peak and count of the allocations made through this device, per tag
+    hx::memory::AllocationTracker &getAllocationTracker() const {
+        return _allocationTracker;
+    }
+
 private:
+    hx::memory::Storage tracked(hx::memory::Storage storage,
+                                const std::string &tag) const {
+        storage.track(_allocationTracker.counters(tag));
+        return storage;
+    }
+
     hx::ThreadPool<> _defaultThreadPool;
+    // mutable, handing out storage is const but has to be counted
+    mutable hx::memory::AllocationTracker _allocationTracker;
 };
 }// namespace hx
\ No newline at end of file
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace hx {
+
+// Completion flag shared between streams and the host. Copies refer to the same
+// event. An event completed with an exception rethrows it from wait() and passes it
+// on to the streams waiting for it.
+class Event {
+public:
+    Event() : _state(std::make_shared<State>()) {}
+
+    bool isComplete() const {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        return _state->complete;
+    }
+
+    // blocks the calling thread, never call it from the device pool
+    void wait() const {
+        std::unique_lock<std::mutex> lock(_state->mutex);
+        _state->completed.wait(lock, [this] { return _state->complete; });
+        if (_state->error) std::rethrow_exception(_state->error);
+    }
+
+    // Whether the event has completed, its error if so, in one look under the lock
+    bool isComplete(std::exception_ptr &error) const {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        if (_state->complete) error = _state->error;
+        return _state->complete;
+    }
+
+    // Completes the event, from the host for events not recorded on a stream.
+    // Completing twice has no effect.
+    void complete(std::exception_ptr error = nullptr) const {
+        std::vector<std::function<void(std::exception_ptr)>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            if (_state->complete) return;
+            _state->complete = true;
+            _state->error = error;
+            callbacks.swap(_state->callbacks);
+        }
+        _state->completed.notify_all();
+
+        for (auto &callback : callbacks)
+            callback(error);
+    }
+
+    // Runs `callback(error)` once the event completes, right away if it already
+    // has, on the thread completing it otherwise. Meant for short callbacks.
+    template <typename Function>
+    void onComplete(Function callback) const {
+        std::unique_lock<std::mutex> lock(_state->mutex);
+        if (!_state->complete) {
+            _state->callbacks.emplace_back(std::move(callback));
+            return;
+        }
+
+        auto error = _state->error;
+        lock.unlock();
+        callback(error);
+    }
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::condition_variable completed;
+        bool complete = false;
+        std::exception_ptr error;
+        std::vector<std::function<void(std::exception_ptr)>> callbacks;
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+// Ordered queue of work executed on a thread pool, one item at a time. Items of
+// different streams run concurrently, so e.g. copying in the next batch overlaps
+// with scoring the current one. A stream waiting for an event is parked rather
+// than holding a worker, so waits never starve the pool.
+//
+// Once an item throws, the rest of the queued work is skipped and events recorded
+// behind it complete with the exception, until synchronize() reports it.
+template <typename Pool>
+class Stream {
+public:
+    explicit Stream(Pool &pool) : _state(std::make_shared<State>(pool)) {}
+
+    Stream(const Stream &) = delete;
+    Stream &operator=(const Stream &) = delete;
+    Stream(Stream &&) = default;
+
+    // waits for the queued work, errors are dropped
+    ~Stream() {
+        if (!_state) return;
+        try {
+            this->synchronize();
+        } catch (...) {
+        }
+    }
+
+    // queues `f()`, run after everything queued before it
+    template <typename Function>
+    Stream &enqueue(Function f) {
+        _state->push(Item{Item::WORK, std::function<void()>(std::move(f)), Event()});
+        return *this;
+    }
+
+    // event completing once the work queued so far is done
+    Event record() {
+        Event event;
+        _state->push(Item{Item::RECORD, nullptr, event});
+        return event;
+    }
+
+    // work queued after this call starts only once `event` completes
+    Stream &wait(const Event &event) {
+        _state->push(Item{Item::WAIT, nullptr, event});
+        return *this;
+    }
+
+    // blocks until the queued work is done, rethrows the first error since the
+    // last synchronize()
+    void synchronize() {
+        auto event = this->record();
+        try {
+            event.wait();
+        } catch (...) {
+            _state->clearError();
+            throw;
+        }
+    }
+
+private:
+    struct Item {
+        enum Kind { WORK, RECORD, WAIT } kind;
+        std::function<void()> work;
+        Event event;
+    };
+
+    struct State : std::enable_shared_from_this<State> {
+        explicit State(Pool &pool) : pool(pool) {}
+
+        void push(Item item) {
+            std::unique_lock<std::mutex> lock(mutex);
+            pending.push_back(std::move(item));
+            this->schedule(std::move(lock));
+        }
+
+        void clearError() {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = nullptr;
+        }
+
+        // Handles records and waits on completed events inline, hands the next work
+        // item to the pool or parks the stream on a pending event
+        void schedule(std::unique_lock<std::mutex> lock) {
+            while (!running && !pending.empty()) {
+                Item item = std::move(pending.front());
+                pending.pop_front();
+
+                if (item.kind == Item::RECORD) {
+                    auto status = error;
+                    lock.unlock();
+                    item.event.complete(status);
+                    lock.lock();
+                    continue;
+                }
+
+                // waits on events already complete are passed inline, parking and
+                // resuming would recurse once per wait
+                std::exception_ptr status;
+                if (item.kind == Item::WAIT && item.event.isComplete(status)) {
+                    if (!error) error = status;
+                    continue;
+                }
+
+                running = true;
+                auto self = this->shared_from_this();
+                lock.unlock();
+
+                if (item.kind == Item::WAIT) {
+                    item.event.onComplete([self](std::exception_ptr status) {
+                        self->resume(status);
+                    });
+                } else {
+                    pool.async_task([self, work = std::move(item.work)]() -> bool {
+                        self->run(work);
+                        return true;
+                    });
+                }
+                return;
+            }
+        }
+
+        void run(const std::function<void()> &work) {
+            std::exception_ptr status;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                status = error;
+            }
+
+            if (!status) {
+                try {
+                    work();
+                } catch (...) {
+                    status = std::current_exception();
+                }
+            }
+            this->resume(status);
+        }
+
+        void resume(std::exception_ptr status) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!error) error = status;
+            running = false;
+            this->schedule(std::move(lock));
+        }
+
+        Pool &pool;
+        std::mutex mutex;
+        std::deque<Item> pending;
+        bool running = false;
+        std::exception_ptr error;
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+}// namespace hx
\ No newline at end of file
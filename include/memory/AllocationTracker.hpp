@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <iomanip>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace hx {
+namespace memory {
+
+struct AllocationStatistics {
+    std::size_t liveBytes = 0;
+    std::size_t peakBytes = 0;
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+
+    std::size_t liveAllocations() const { return allocations - deallocations; }
+};
+
+// Lock free counters of one tag, every update is also applied to the parent, which
+// keeps the totals of the device
+class AllocationCounters {
+public:
+    explicit AllocationCounters(AllocationCounters *parent = nullptr) : _parent(parent) {}
+
+    AllocationCounters(const AllocationCounters &) = delete;
+    AllocationCounters &operator=(const AllocationCounters &) = delete;
+
+    void allocated(std::size_t bytes) noexcept {
+        _allocations.fetch_add(1, std::memory_order_relaxed);
+        auto live = _liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        auto peak = _peakBytes.load(std::memory_order_relaxed);
+        while (live > peak
+               && !_peakBytes.compare_exchange_weak(
+                   peak, live, std::memory_order_relaxed)) {
+        }
+
+        if (_parent) _parent->allocated(bytes);
+    }
+
+    void released(std::size_t bytes) noexcept {
+        _deallocations.fetch_add(1, std::memory_order_relaxed);
+        _liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+
+        if (_parent) _parent->released(bytes);
+    }
+
+    // the counters are read one by one, a snapshot taken under concurrent
+    // allocations is only approximately consistent
+    AllocationStatistics statistics() const {
+        AllocationStatistics result;
+        result.liveBytes = _liveBytes.load(std::memory_order_relaxed);
+        result.peakBytes = _peakBytes.load(std::memory_order_relaxed);
+        result.allocations = _allocations.load(std::memory_order_relaxed);
+        result.deallocations = _deallocations.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    // starts a new high water mark, e.g. per epoch
+    void resetPeak() noexcept {
+        _peakBytes.store(_liveBytes.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+    }
+
+private:
+    AllocationCounters *_parent;
+
+    std::atomic<std::size_t> _liveBytes{0};
+    std::atomic<std::size_t> _peakBytes{0};
+    std::atomic<std::size_t> _allocations{0};
+    std::atomic<std::size_t> _deallocations{0};
+};
+
+// Allocation statistics of a device, split by tag ("population", "control_points",
+// ...). Looking a tag up takes a lock, counting against it afterwards does not.
+class AllocationTracker {
+public:
+    constexpr static const char *UNTAGGED = "untagged";
+
+    AllocationTracker() = default;
+    AllocationTracker(const AllocationTracker &) = delete;
+    AllocationTracker &operator=(const AllocationTracker &) = delete;
+
+    // counters of `tag`, created on first use and valid as long as the tracker
+    AllocationCounters &counters(const std::string &tag) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _tags.try_emplace(tag, &_total).first->second;
+    }
+
+    AllocationStatistics total() const { return _total.statistics(); }
+
+    std::map<std::string, AllocationStatistics> snapshot() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::map<std::string, AllocationStatistics> result;
+        for (const auto &[tag, counters] : _tags)
+            result.emplace(tag, counters.statistics());
+        return result;
+    }
+
+    // One line per tag with live and peak bytes; with `leaksOnly` only the tags still
+    // holding memory, meant to be called once everything should have been released.
+    void report(std::ostream &out, bool leaksOnly = false) const {
+        auto line = [&out](const std::string &tag, const AllocationStatistics &stats) {
+            out << std::left << std::setw(24) << tag << std::right
+                << " live " << std::setw(12) << stats.liveBytes << " B in "
+                << std::setw(6) << stats.liveAllocations() << ", peak "
+                << std::setw(12) << stats.peakBytes << " B, "
+                << stats.allocations << " allocations\n";
+        };
+
+        for (const auto &[tag, stats] : this->snapshot())
+            if (!leaksOnly || stats.liveBytes > 0) line(tag, stats);
+        line("total", this->total());
+    }
+
+private:
+    AllocationCounters _total;
+    mutable std::mutex _mutex;
+    std::map<std::string, AllocationCounters> _tags;
+};
+
+// Counts what a resource draws from upstream, so wrapping the upstream of a pool
+// shows the pool's real footprint next to what its users asked for
+class TrackingResource : public std::pmr::memory_resource {
+public:
+    explicit TrackingResource(
+        AllocationCounters &counters,
+        std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+        : _counters(counters), _upstream(upstream) {}
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        void *p = _upstream->allocate(bytes, alignment);
+        _counters.allocated(bytes);
+        return p;
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+        _upstream->deallocate(p, bytes, alignment);
+        _counters.released(bytes);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+    AllocationCounters &_counters;
+    std::pmr::memory_resource *_upstream;
+};
+
+}// namespace memory
+}// namespace hx
\ No newline at end of file
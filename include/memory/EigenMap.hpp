@@ -0,0 +1,67 @@
+#pragma once
+
+#include <type_traits>
+
+#include <Eigen/Core>
+
+#include "memory/View.hpp"
+
+namespace hx {
+namespace memory {
+
+// Zero copy Eigen views of View/StorageView. Matrices are row major, with the view's
+// strides passed on, so padded rule and control point rows map directly.
+template <typename T>
+using RowMajorMatrix = Eigen::
+    Matrix<std::remove_const_t<T>, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+using DynamicStride = Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>;
+using DynamicInnerStride = Eigen::InnerStride<Eigen::Dynamic>;
+
+template <typename T>
+using EigenMatrixMap = Eigen::Map<RowMajorMatrix<T>, Eigen::Unaligned, DynamicStride>;
+
+template <typename T>
+using EigenConstMatrixMap =
+    Eigen::Map<const RowMajorMatrix<T>, Eigen::Unaligned, DynamicStride>;
+
+template <typename T>
+using ColumnVector = Eigen::Matrix<std::remove_const_t<T>, Eigen::Dynamic, 1>;
+
+template <typename T>
+using EigenVectorMap = Eigen::Map<ColumnVector<T>, Eigen::Unaligned, DynamicInnerStride>;
+
+template <typename T>
+using EigenConstVectorMap =
+    Eigen::Map<const ColumnVector<T>, Eigen::Unaligned, DynamicInnerStride>;
+
+template <typename T>
+EigenMatrixMap<T> asEigen(View<T, 2> &view) {
+    return EigenMatrixMap<T>(view.data(),
+                             view.size(0),
+                             view.size(1),
+                             DynamicStride(view.stride(0), view.stride(1)));
+}
+
+template <typename T>
+EigenConstMatrixMap<T> asEigen(const View<T, 2> &view) {
+    return EigenConstMatrixMap<T>(view.data(),
+                                  view.size(0),
+                                  view.size(1),
+                                  DynamicStride(view.stride(0), view.stride(1)));
+}
+
+template <typename T>
+EigenVectorMap<T> asEigen(View<T, 1> &view) {
+    return EigenVectorMap<T>(
+        view.data(), view.size(0), DynamicInnerStride(view.stride(0)));
+}
+
+template <typename T>
+EigenConstVectorMap<T> asEigen(const View<T, 1> &view) {
+    return EigenConstVectorMap<T>(
+        view.data(), view.size(0), DynamicInnerStride(view.stride(0)));
+}
+
+}// namespace memory
+}// namespace hx
\ No newline at end of file
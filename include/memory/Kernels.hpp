@@ -0,0 +1,553 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "memory/View.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define __HX_KERNELS_X86 1
+#endif
+
+namespace hx {
+namespace memory {
+
+enum class Comparison : uint8_t { LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, EQUAL };
+
+// Instruction set picked once at runtime, float rows use it, other types go through
+// plain loops left to the compiler
+enum class KernelIsa : uint8_t { SCALAR, AVX2, AVX512 };
+
+namespace __internal {
+
+inline KernelIsa detectKernelIsa() {
+#ifdef __HX_KERNELS_X86
+    if (__builtin_cpu_supports("avx512f")) return KernelIsa::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return KernelIsa::AVX2;
+#endif
+    return KernelIsa::SCALAR;
+}
+
+}// namespace __internal
+
+inline KernelIsa kernelIsa() {
+    static const KernelIsa isa = __internal::detectKernelIsa();
+    return isa;
+}
+
+namespace __internal {
+
+template <typename T>
+bool compare(T value, Comparison comparison, T reference) {
+    switch (comparison) {
+        case Comparison::LESS:
+            return value < reference;
+        case Comparison::LESS_EQUAL:
+            return value <= reference;
+        case Comparison::GREATER:
+            return value > reference;
+        case Comparison::GREATER_EQUAL:
+            return value >= reference;
+        default:
+            return value == reference;
+    }
+}
+
+template <typename>
+struct ViewRank;
+
+template <typename T, std::size_t Dimensions>
+struct ViewRank<View<T, Dimensions>> : std::integral_constant<std::size_t, Dimensions> {};
+
+template <typename T, std::size_t Dimensions>
+bool isDense(const View<T, Dimensions> &view) {
+    std::size_t stride = 1;
+    for (std::size_t i = Dimensions; i > 0; --i) {
+        if (view.size(i - 1) != 1 && view.stride(i - 1) != stride) return false;
+        stride *= view.size(i - 1);
+    }
+    return true;
+}
+
+// Calls f(length, innerStrides, rowPointers...) for every innermost row of the views,
+// which all share the shape of the first one. Views that are all dense are handed
+// over as one long row.
+template <typename Function, typename First, typename... Views>
+void forEachRow(Function f, First &first, Views &... views) {
+    constexpr std::size_t dimensions = ViewRank<std::remove_const_t<First>>::value;
+    constexpr std::size_t count = 1 + sizeof...(Views);
+
+    if (isDense(first) && (... && isDense(views))) {
+        std::size_t size = 1;
+        for (std::size_t i = 0; i < dimensions; ++i)
+            size *= first.size(i);
+
+        std::array<std::size_t, count> strides;
+        strides.fill(1);
+        f(size, strides, first.data(), views.data()...);
+        return;
+    }
+
+    std::size_t rows = 1;
+    for (std::size_t i = 0; i + 1 < dimensions; ++i)
+        rows *= first.size(i);
+
+    const std::size_t length = first.size(dimensions - 1);
+    const std::array<std::size_t, count> strides = {first.stride(dimensions - 1),
+                                                    views.stride(dimensions - 1)...};
+
+    std::array<std::size_t, dimensions> index{};
+    for (std::size_t row = 0; row < rows; ++row) {
+        auto offset = [&index](const auto &view) {
+            std::size_t result = 0;
+            for (std::size_t i = 0; i + 1 < dimensions; ++i)
+                result += index[i] * view.stride(i);
+            return result;
+        };
+        f(length, strides, first.data() + offset(first), views.data() + offset(views)...);
+
+        for (std::size_t i = dimensions - 1; i > 0; --i) {
+            if (++index[i - 1] < first.size(i - 1)) break;
+            index[i - 1] = 0;
+        }
+    }
+}
+
+// Float rows, `AVX2` and `AVX512` variants are only called after detectKernelIsa().
+// Stores are aligned after a scalar prologue, so 32 byte aligned storages (see
+// DeviceCPU::getSpecialAllocator) skip the prologue entirely.
+#ifdef __HX_KERNELS_X86
+template <std::size_t Alignment>
+std::size_t prologue(const float *data, std::size_t size) {
+    auto misalignment = reinterpret_cast<std::uintptr_t>(data) % Alignment;
+    if (misalignment % sizeof(float)) return size;
+    auto head = misalignment ? (Alignment - misalignment) / sizeof(float) : 0;
+    return std::min(head, size);
+}
+
+__attribute__((target("avx2,fma"))) inline void fillAVX2(float *y,
+                                                         std::size_t size,
+                                                         float value) {
+    std::size_t i = prologue<32>(y, size);
+    std::fill(y, y + i, value);
+    const __m256i v = _mm256_castps_si256(_mm256_set1_ps(value));
+    for (; i + 8 <= size; i += 8)
+        _mm256_store_si256(reinterpret_cast<__m256i *>(y + i), v);
+    std::fill(y + i, y + size, value);
+}
+
+__attribute__((target("avx512f"))) inline void fillAVX512(float *y,
+                                                          std::size_t size,
+                                                          float value) {
+    std::size_t i = prologue<64>(y, size);
+    std::fill(y, y + i, value);
+    const __m512 v = _mm512_set1_ps(value);
+    for (; i + 16 <= size; i += 16)
+        _mm512_store_ps(y + i, v);
+    std::fill(y + i, y + size, value);
+}
+
+__attribute__((target("avx2,fma"))) inline void axpyAVX2(float a,
+                                                         const float *x,
+                                                         float *y,
+                                                         std::size_t size) {
+    std::size_t i = prologue<32>(y, size);
+    for (std::size_t j = 0; j < i; ++j)
+        y[j] += a * x[j];
+    const __m256 va = _mm256_set1_ps(a);
+    for (; i + 8 <= size; i += 8)
+        _mm256_store_ps(
+            y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_load_ps(y + i)));
+    for (; i < size; ++i)
+        y[i] += a * x[i];
+}
+
+__attribute__((target("avx512f"))) inline void axpyAVX512(float a,
+                                                          const float *x,
+                                                          float *y,
+                                                          std::size_t size) {
+    std::size_t i = prologue<64>(y, size);
+    for (std::size_t j = 0; j < i; ++j)
+        y[j] += a * x[j];
+    const __m512 va = _mm512_set1_ps(a);
+    for (; i + 16 <= size; i += 16)
+        _mm512_store_ps(
+            y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_load_ps(y + i)));
+    for (; i < size; ++i)
+        y[i] += a * x[i];
+}
+
+// reductions: sum, min and max in one pass shape, `Op` picks the lane operation
+enum class ReduceOp : uint8_t { SUM, MIN, MAX };
+
+template <ReduceOp Op>
+float reduceScalar(float accumulator, float value) {
+    if constexpr (Op == ReduceOp::SUM) return accumulator + value;
+    if constexpr (Op == ReduceOp::MIN) return std::min(accumulator, value);
+    if constexpr (Op == ReduceOp::MAX) return std::max(accumulator, value);
+}
+
+template <ReduceOp Op>
+__attribute__((target("avx2,fma"))) float reduceAVX2(const float *x,
+                                                     std::size_t size,
+                                                     float identity) {
+    float result = identity;
+    std::size_t i = prologue<32>(x, size);
+    for (std::size_t j = 0; j < i; ++j)
+        result = reduceScalar<Op>(result, x[j]);
+
+    // two accumulators hide the latency of the dependent adds
+    __m256 a0 = _mm256_set1_ps(identity), a1 = a0;
+    for (; i + 16 <= size; i += 16) {
+        __m256 v0 = _mm256_load_ps(x + i), v1 = _mm256_load_ps(x + i + 8);
+        if constexpr (Op == ReduceOp::SUM) {
+            a0 = _mm256_add_ps(a0, v0), a1 = _mm256_add_ps(a1, v1);
+        } else if constexpr (Op == ReduceOp::MIN) {
+            a0 = _mm256_min_ps(a0, v0), a1 = _mm256_min_ps(a1, v1);
+        } else {
+            a0 = _mm256_max_ps(a0, v0), a1 = _mm256_max_ps(a1, v1);
+        }
+    }
+
+    alignas(32) float lanes[16];
+    _mm256_store_ps(lanes, a0);
+    _mm256_store_ps(lanes + 8, a1);
+    for (float lane : lanes)
+        result = reduceScalar<Op>(result, lane);
+    for (; i < size; ++i)
+        result = reduceScalar<Op>(result, x[i]);
+    return result;
+}
+
+template <ReduceOp Op>
+__attribute__((target("avx512f"))) float reduceAVX512(const float *x,
+                                                      std::size_t size,
+                                                      float identity) {
+    float result = identity;
+    std::size_t i = prologue<64>(x, size);
+    for (std::size_t j = 0; j < i; ++j)
+        result = reduceScalar<Op>(result, x[j]);
+
+    // min and max go through the masked forms with a full mask, the unmasked ones
+    // trip -Wmaybe-uninitialized inside the GCC headers
+    const __mmask16 all = 0xffff;
+    __m512 a0 = _mm512_set1_ps(identity), a1 = a0;
+    for (; i + 32 <= size; i += 32) {
+        __m512 v0 = _mm512_load_ps(x + i), v1 = _mm512_load_ps(x + i + 16);
+        if constexpr (Op == ReduceOp::SUM) {
+            a0 = _mm512_add_ps(a0, v0), a1 = _mm512_add_ps(a1, v1);
+        } else if constexpr (Op == ReduceOp::MIN) {
+            a0 = _mm512_mask_min_ps(a0, all, a0, v0);
+            a1 = _mm512_mask_min_ps(a1, all, a1, v1);
+        } else {
+            a0 = _mm512_mask_max_ps(a0, all, a0, v0);
+            a1 = _mm512_mask_max_ps(a1, all, a1, v1);
+        }
+    }
+
+    alignas(64) float lanes[32];
+    _mm512_store_ps(lanes, a0);
+    _mm512_store_ps(lanes + 16, a1);
+    for (float lane : lanes)
+        result = reduceScalar<Op>(result, lane);
+    for (; i < size; ++i)
+        result = reduceScalar<Op>(result, x[i]);
+    return result;
+}
+
+// count kernels only go over whole vectors, `processed` tells where the tail starts
+template <int Predicate>
+__attribute__((target("avx2,fma"))) std::size_t countAVX2(const float *x,
+                                                          std::size_t size,
+                                                          float reference,
+                                                          std::size_t &processed) {
+    std::size_t result = 0, i = 0;
+    const __m256 r = _mm256_set1_ps(reference);
+    for (; i + 8 <= size; i += 8)
+        result += __builtin_popcount(
+            _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(x + i), r, Predicate)));
+    processed = i;
+    return result;
+}
+
+template <int Predicate>
+__attribute__((target("avx512f"))) std::size_t countAVX512(const float *x,
+                                                           std::size_t size,
+                                                           float reference,
+                                                           std::size_t &processed) {
+    std::size_t result = 0, i = 0;
+    const __m512 r = _mm512_set1_ps(reference);
+    for (; i + 16 <= size; i += 16)
+        result +=
+            __builtin_popcount(_mm512_cmp_ps_mask(_mm512_loadu_ps(x + i), r, Predicate));
+    processed = i;
+    return result;
+}
+
+template <int Predicate>
+std::size_t countVector(const float *x,
+                        std::size_t size,
+                        float reference,
+                        std::size_t &processed) {
+    return kernelIsa() == KernelIsa::AVX512
+               ? countAVX512<Predicate>(x, size, reference, processed)
+               : countAVX2<Predicate>(x, size, reference, processed);
+}
+
+inline std::size_t countVector(const float *x,
+                               std::size_t size,
+                               Comparison comparison,
+                               float reference,
+                               std::size_t &processed) {
+    switch (comparison) {
+        case Comparison::LESS:
+            return countVector<_CMP_LT_OQ>(x, size, reference, processed);
+        case Comparison::LESS_EQUAL:
+            return countVector<_CMP_LE_OQ>(x, size, reference, processed);
+        case Comparison::GREATER:
+            return countVector<_CMP_GT_OQ>(x, size, reference, processed);
+        case Comparison::GREATER_EQUAL:
+            return countVector<_CMP_GE_OQ>(x, size, reference, processed);
+        default:
+            return countVector<_CMP_EQ_OQ>(x, size, reference, processed);
+    }
+}
+#endif
+}// namespace __internal
+
+template <typename T, std::size_t Dimensions>
+void fill(View<T, Dimensions> &view, T value) {
+    __internal::forEachRow(
+        [value](std::size_t size, const auto &strides, T *y) {
+#ifdef __HX_KERNELS_X86
+            if constexpr (std::is_same_v<T, float>) {
+                if (strides[0] == 1 && kernelIsa() == KernelIsa::AVX512)
+                    return __internal::fillAVX512(y, size, value);
+                if (strides[0] == 1 && kernelIsa() == KernelIsa::AVX2)
+                    return __internal::fillAVX2(y, size, value);
+            }
+#endif
+            for (std::size_t i = 0; i < size; ++i)
+                y[i * strides[0]] = value;
+        },
+        view);
+}
+
+template <typename T, std::size_t Dimensions>
+void copy(const View<T, Dimensions> &source, View<T, Dimensions> &destination) {
+    __internal::forEachRow(
+        [](std::size_t size, const auto &strides, T *y, const T *x) {
+            if (strides[0] == 1 && strides[1] == 1 && std::is_trivially_copyable_v<T>) {
+                std::memcpy(y, x, size * sizeof(T));
+                return;
+            }
+            for (std::size_t i = 0; i < size; ++i)
+                y[i * strides[0]] = x[i * strides[1]];
+        },
+        destination,
+        source);
+}
+
+// destination = f(source), element by element
+template <typename T, typename U, std::size_t Dimensions, typename Function>
+void transform(const View<T, Dimensions> &source,
+               View<U, Dimensions> &destination,
+               Function f) {
+    __internal::forEachRow(
+        [&f](std::size_t size, const auto &strides, U *y, const T *x) {
+            if (strides[0] == 1 && strides[1] == 1) {
+                for (std::size_t i = 0; i < size; ++i)
+                    y[i] = f(x[i]);
+            } else {
+                for (std::size_t i = 0; i < size; ++i)
+                    y[i * strides[0]] = f(x[i * strides[1]]);
+            }
+        },
+        destination,
+        source);
+}
+
+// y = a * x + y
+template <typename T, std::size_t Dimensions>
+void axpy(T a, const View<T, Dimensions> &x, View<T, Dimensions> &y) {
+    __internal::forEachRow(
+        [a](std::size_t size, const auto &strides, T *y, const T *x) {
+#ifdef __HX_KERNELS_X86
+            if constexpr (std::is_same_v<T, float>) {
+                if (strides[0] == 1 && strides[1] == 1) {
+                    if (kernelIsa() == KernelIsa::AVX512)
+                        return __internal::axpyAVX512(a, x, y, size);
+                    if (kernelIsa() == KernelIsa::AVX2)
+                        return __internal::axpyAVX2(a, x, y, size);
+                }
+            }
+#endif
+            for (std::size_t i = 0; i < size; ++i)
+                y[i * strides[0]] += a * x[i * strides[1]];
+        },
+        y,
+        x);
+}
+
+namespace __internal {
+template <ReduceOp Op, typename T, std::size_t Dimensions>
+T reduce(const View<T, Dimensions> &view, T identity) {
+    T result = identity;
+    forEachRow(
+        [&result, identity](std::size_t size, const auto &strides, const T *x) {
+#ifdef __HX_KERNELS_X86
+            if constexpr (std::is_same_v<T, float>) {
+                if (strides[0] == 1 && kernelIsa() != KernelIsa::SCALAR) {
+                    result = reduceScalar<Op>(result,
+                                              kernelIsa() == KernelIsa::AVX512
+                                                  ? reduceAVX512<Op>(x, size, identity)
+                                                  : reduceAVX2<Op>(x, size, identity));
+                    return;
+                }
+            }
+#endif
+            for (std::size_t i = 0; i < size; ++i) {
+                const T value = x[i * strides[0]];
+                if constexpr (Op == ReduceOp::SUM) result += value;
+                if constexpr (Op == ReduceOp::MIN) result = std::min(result, value);
+                if constexpr (Op == ReduceOp::MAX) result = std::max(result, value);
+            }
+        },
+        view);
+    return result;
+}
+}// namespace __internal
+
+template <typename T, std::size_t Dimensions>
+T sum(const View<T, Dimensions> &view) {
+    return __internal::reduce<__internal::ReduceOp::SUM>(view, T(0));
+}
+
+// numeric_limits<T>::max() for an empty view
+template <typename T, std::size_t Dimensions>
+T min(const View<T, Dimensions> &view) {
+    return __internal::reduce<__internal::ReduceOp::MIN>(view,
+                                                        std::numeric_limits<T>::max());
+}
+
+// numeric_limits<T>::lowest() for an empty view
+template <typename T, std::size_t Dimensions>
+T max(const View<T, Dimensions> &view) {
+    return __internal::reduce<__internal::ReduceOp::MAX>(view,
+                                                        std::numeric_limits<T>::lowest());
+}
+
+// number of elements for which `element <comparison> reference` holds
+template <typename T, std::size_t Dimensions>
+std::size_t count(const View<T, Dimensions> &view, Comparison comparison, T reference) {
+    std::size_t result = 0;
+    __internal::forEachRow(
+        [&result, comparison, reference](
+            std::size_t size, const auto &strides, const T *x) {
+#ifdef __HX_KERNELS_X86
+            if constexpr (std::is_same_v<T, float>) {
+                if (strides[0] == 1 && kernelIsa() != KernelIsa::SCALAR) {
+                    std::size_t i;
+                    result += __internal::countVector(x, size, comparison, reference, i);
+                    for (; i < size; ++i)
+                        result += __internal::compare(x[i], comparison, reference);
+                    return;
+                }
+            }
+#endif
+            for (std::size_t i = 0; i < size; ++i)
+                result += __internal::compare(x[i * strides[0]], comparison, reference);
+        },
+        view);
+    return result;
+}
+
+// result = element <comparison> reference, as 0 or 1
+template <typename T, std::size_t Dimensions>
+void compare(const View<T, Dimensions> &view,
+             Comparison comparison,
+             T reference,
+             View<std::uint8_t, Dimensions> &result) {
+    __internal::forEachRow(
+        [comparison, reference](
+            std::size_t size, const auto &strides, std::uint8_t *y, const T *x) {
+            for (std::size_t i = 0; i < size; ++i)
+                y[i * strides[0]] =
+                    __internal::compare(x[i * strides[1]], comparison, reference);
+        },
+        result,
+        view);
+}
+
+namespace __internal {
+// splits the outermost dimension into at most `parts` views
+template <typename T, std::size_t Dimensions>
+std::vector<View<T, Dimensions>> splitOuter(const View<T, Dimensions> &view,
+                                            std::size_t parts) {
+    std::vector<View<T, Dimensions>> result;
+    const std::size_t outer = view.size(0);
+    const std::size_t chunk = (outer + parts - 1) / std::max<std::size_t>(parts, 1);
+
+    for (std::size_t begin = 0; begin < outer; begin += chunk) {
+        auto sizes = view.shape();
+        sizes[0] = std::min(chunk, outer - begin);
+        result.emplace_back(const_cast<T *>(view.data()) + begin * view.stride(0),
+                            view.strides(),
+                            sizes);
+    }
+    return result;
+}
+}// namespace __internal
+
+// Thread pool variants, the outermost dimension is split between the workers
+
+template <typename T, std::size_t Dimensions, typename Pool>
+void fill(View<T, Dimensions> &view, T value, Pool &pool) {
+    std::vector<std::future<std::size_t>> done;
+    for (auto part : __internal::splitOuter(view, pool.size()))
+        done.push_back(pool.async_task([part, value]() mutable -> std::size_t {
+            fill(part, value);
+            return part.size(0);
+        }));
+    for (auto &it : done)
+        it.get();
+}
+
+template <typename T, std::size_t Dimensions, typename Pool>
+void axpy(T a, const View<T, Dimensions> &x, View<T, Dimensions> &y, Pool &pool) {
+    auto xParts = __internal::splitOuter(x, pool.size());
+    auto yParts = __internal::splitOuter(y, pool.size());
+
+    std::vector<std::future<std::size_t>> done;
+    for (std::size_t i = 0; i < yParts.size(); ++i)
+        done.push_back(pool.async_task(
+            [a, xPart = xParts[i], yPart = yParts[i]]() mutable -> std::size_t {
+                axpy(a, xPart, yPart);
+                return yPart.size(0);
+            }));
+    for (auto &it : done)
+        it.get();
+}
+
+template <typename T, std::size_t Dimensions, typename Pool>
+T sum(const View<T, Dimensions> &view, Pool &pool) {
+    std::vector<std::future<T>> partial;
+    for (auto part : __internal::splitOuter(view, pool.size()))
+        partial.push_back(pool.async_task([part]() -> T { return sum(part); }));
+
+    T result = 0;
+    for (auto &it : partial)
+        result += it.get();
+    return result;
+}
+
+}// namespace memory
+}// namespace hx
\ No newline at end of file
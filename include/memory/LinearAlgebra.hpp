@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "memory/EigenMap.hpp"
+#include "memory/Kernels.hpp"
+#include "memory/View.hpp"
+
+#ifdef __HX_SUPPORT_MKL
+#include <mkl.h>
+#endif
+
+namespace hx {
+namespace memory {
+
+// MKL is only used when built with -DHX_MKL_KERNELS=ON, which defines
+// __HX_SUPPORT_MKL; Eigen runs everything otherwise.
+
+// C = alpha * A * B + beta * C, C is not read when beta is 0. Float matrices with
+// contiguous rows go to MKL sgemm when available, everything else through Eigen.
+template <typename T>
+void gemm(T alpha, const View<T, 2> &a, const View<T, 2> &b, T beta, View<T, 2> &c) {
+    if (a.size(1) != b.size(0) || c.size(0) != a.size(0) || c.size(1) != b.size(1))
+        throw std::invalid_argument("gemm: incompatible matrix shapes");
+
+#ifdef __HX_SUPPORT_MKL
+    if constexpr (std::is_same_v<T, float>) {
+        if (a.stride(1) == 1 && b.stride(1) == 1 && c.stride(1) == 1) {
+            cblas_sgemm(CblasRowMajor,
+                        CblasNoTrans,
+                        CblasNoTrans,
+                        static_cast<MKL_INT>(c.size(0)),
+                        static_cast<MKL_INT>(c.size(1)),
+                        static_cast<MKL_INT>(a.size(1)),
+                        alpha,
+                        a.data(),
+                        static_cast<MKL_INT>(std::max<std::size_t>(a.stride(0), 1)),
+                        b.data(),
+                        static_cast<MKL_INT>(std::max<std::size_t>(b.stride(0), 1)),
+                        beta,
+                        c.data(),
+                        static_cast<MKL_INT>(std::max<std::size_t>(c.stride(0), 1)));
+            return;
+        }
+    }
+#endif
+
+    auto result = asEigen(c);
+    if (beta == T(0)) {
+        result.noalias() = alpha * asEigen(a) * asEigen(b);
+    } else {
+        result *= beta;
+        result.noalias() += alpha * asEigen(a) * asEigen(b);
+    }
+}
+
+namespace __internal {
+
+enum class VectorFunction : uint8_t { EXP, LOG, SQRT };
+
+template <typename T>
+using RowArray = Eigen::Map<Eigen::Array<std::remove_const_t<T>, Eigen::Dynamic, 1>,
+                            Eigen::Unaligned,
+                            DynamicInnerStride>;
+
+template <typename T>
+using ConstRowArray = Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>,
+                                 Eigen::Unaligned,
+                                 DynamicInnerStride>;
+
+template <VectorFunction Function, typename Row>
+auto applyVectorFunction(const Row &row) {
+    if constexpr (Function == VectorFunction::EXP) return row.exp();
+    if constexpr (Function == VectorFunction::LOG) return row.log();
+    if constexpr (Function == VectorFunction::SQRT) return row.sqrt();
+}
+
+// y = f(x) row by row, contiguous float rows go to MKL VM when available
+template <VectorFunction Function, typename T, std::size_t Dimensions>
+void vectorMath(const View<T, Dimensions> &x, View<T, Dimensions> &y) {
+    forEachRow(
+        [](std::size_t size, const auto &strides, T *output, const T *input) {
+#ifdef __HX_SUPPORT_MKL
+            if constexpr (std::is_same_v<T, float>) {
+                if (strides[0] == 1 && strides[1] == 1) {
+                    const auto n = static_cast<MKL_INT>(size);
+                    if constexpr (Function == VectorFunction::EXP)
+                        vsExp(n, input, output);
+                    if constexpr (Function == VectorFunction::LOG)
+                        vsLn(n, input, output);
+                    if constexpr (Function == VectorFunction::SQRT)
+                        vsSqrt(n, input, output);
+                    return;
+                }
+            }
+#endif
+            const ConstRowArray<T> source(input, size, DynamicInnerStride(strides[1]));
+            RowArray<T>(output, size, DynamicInnerStride(strides[0])) =
+                applyVectorFunction<Function>(source);
+        },
+        y,
+        x);
+}
+
+}// namespace __internal
+
+// Element wise y = exp(x), log(x) and sqrt(x), x and y may be the same view
+
+template <typename T, std::size_t Dimensions>
+void exp(const View<T, Dimensions> &x, View<T, Dimensions> &y) {
+    __internal::vectorMath<__internal::VectorFunction::EXP>(x, y);
+}
+
+template <typename T, std::size_t Dimensions>
+void log(const View<T, Dimensions> &x, View<T, Dimensions> &y) {
+    __internal::vectorMath<__internal::VectorFunction::LOG>(x, y);
+}
+
+template <typename T, std::size_t Dimensions>
+void sqrt(const View<T, Dimensions> &x, View<T, Dimensions> &y) {
+    __internal::vectorMath<__internal::VectorFunction::SQRT>(x, y);
+}
+
+// Stream of random floats filling whole views at once. Backed by an MKL VSL
+// Mersenne twister when available, std::mt19937 otherwise, so the values differ
+// between the two builds for the same seed.
+class RandomStream {
+public:
+    explicit RandomStream(std::uint32_t seed = 5489u) {
+#ifdef __HX_SUPPORT_MKL
+        if (vslNewStream(&_stream, VSL_BRNG_MT19937, seed) != VSL_STATUS_OK)
+            throw std::runtime_error("vslNewStream failed");
+#else
+        _engine.seed(seed);
+#endif
+    }
+
+    ~RandomStream() {
+#ifdef __HX_SUPPORT_MKL
+        vslDeleteStream(&_stream);
+#endif
+    }
+
+    RandomStream(const RandomStream &) = delete;
+    RandomStream &operator=(const RandomStream &) = delete;
+
+    template <std::size_t Dimensions>
+    void gaussian(View<float, Dimensions> &view, float mean = 0.f, float sigma = 1.f) {
+        this->generate(view, [this, mean, sigma](std::size_t size, float *output) {
+#ifdef __HX_SUPPORT_MKL
+            vsRngGaussian(VSL_RNG_METHOD_GAUSSIAN_ICDF,
+                          _stream,
+                          static_cast<MKL_INT>(size),
+                          output,
+                          mean,
+                          sigma);
+#else
+            std::normal_distribution<float> distribution(mean, sigma);
+            for (std::size_t i = 0; i < size; ++i)
+                output[i] = distribution(_engine);
+#endif
+        });
+    }
+
+    // values in [a, b)
+    template <std::size_t Dimensions>
+    void uniform(View<float, Dimensions> &view, float a = 0.f, float b = 1.f) {
+        this->generate(view, [this, a, b](std::size_t size, float *output) {
+#ifdef __HX_SUPPORT_MKL
+            vsRngUniform(VSL_RNG_METHOD_UNIFORM_STD,
+                         _stream,
+                         static_cast<MKL_INT>(size),
+                         output,
+                         a,
+                         b);
+#else
+            std::uniform_real_distribution<float> distribution(a, b);
+            for (std::size_t i = 0; i < size; ++i)
+                output[i] = distribution(_engine);
+#endif
+        });
+    }
+
+private:
+    // strided rows are generated into a scratch buffer and scattered
+    template <std::size_t Dimensions, typename Generator>
+    void generate(View<float, Dimensions> &view, Generator generator) {
+        __internal::forEachRow(
+            [this, &generator](std::size_t size, const auto &strides, float *output) {
+                if (strides[0] == 1) return generator(size, output);
+
+                _scratch.resize(size);
+                generator(size, _scratch.data());
+                for (std::size_t i = 0; i < size; ++i)
+                    output[i * strides[0]] = _scratch[i];
+            },
+            view);
+    }
+
+#ifdef __HX_SUPPORT_MKL
+    VSLStreamStatePtr _stream = nullptr;
+#else
+    std::mt19937 _engine;
+#endif
+    std::vector<float> _scratch;
+};
+
+}// namespace memory
+}// namespace hx
\ No newline at end of file
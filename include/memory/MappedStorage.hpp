@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "memory/Storage.hpp"
+
+namespace hx {
+namespace memory {
+
+enum class PageMode : uint8_t {
+    SMALL,
+    // madvise(MADV_HUGEPAGE) on a huge page aligned mapping, the kernel may still
+    // back it with small pages
+    TRANSPARENT_HUGE,
+    // MAP_HUGETLB from the reserved pool, falls back to TRANSPARENT_HUGE when the
+    // pool is empty
+    EXPLICIT_HUGE
+};
+
+enum class MappingAccess : uint8_t { READ_ONLY, READ_WRITE };
+
+// buffers from this size up are worth backing with transparent huge pages
+constexpr std::size_t HUGE_PAGE_THRESHOLD = std::size_t(2) << 20;
+
+namespace __internal {
+
+inline std::size_t hugePageSize() {
+    static const std::size_t size = [] {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string key;
+        std::size_t value;
+        while (meminfo >> key >> value) {
+            if (key == "Hugepagesize:") return value * 1024;
+            meminfo.ignore(64, '\n');
+        }
+        return std::size_t(2) << 20;
+    }();
+    return size;
+}
+
+inline void mapping_deleter(void *, void *p, std::size_t size, std::size_t) noexcept {
+    munmap(p, size);
+}
+
+// hugetlb mappings have to be unmapped in whole huge pages
+inline void hugetlb_deleter(void *, void *p, std::size_t size, std::size_t) noexcept {
+    auto pageSize = hugePageSize();
+    munmap(p, (size + pageSize - 1) / pageSize * pageSize);
+}
+
+inline void *mapTransparentHuge(std::size_t size_in_bytes) {
+    // over map by one huge page and trim, so the buffer starts on a huge page
+    const auto pageSize = hugePageSize();
+    const auto length = size_in_bytes + pageSize;
+    void *mapping =
+        mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) throw std::bad_alloc();
+
+    auto begin = reinterpret_cast<std::uintptr_t>(mapping);
+    auto aligned = (begin + pageSize - 1) / pageSize * pageSize;
+    auto end = begin + length;
+    auto alignedEnd =
+        aligned + (size_in_bytes + getpagesize() - 1) / getpagesize() * getpagesize();
+
+    if (aligned != begin) munmap(mapping, aligned - begin);
+    if (alignedEnd != end) munmap(reinterpret_cast<void *>(alignedEnd), end - alignedEnd);
+
+#ifdef MADV_HUGEPAGE
+    madvise(reinterpret_cast<void *>(aligned), size_in_bytes, MADV_HUGEPAGE);
+#endif
+    return reinterpret_cast<void *>(aligned);
+}
+}// namespace __internal
+
+// Anonymous, zero filled mapping
+inline Storage mapAnonymous(std::size_t size_in_bytes,
+                            PageMode mode = PageMode::TRANSPARENT_HUGE) {
+    if (size_in_bytes == 0) return Storage(nullptr, 0);
+
+#ifdef MAP_HUGETLB
+    if (mode == PageMode::EXPLICIT_HUGE) {
+        const auto pageSize = __internal::hugePageSize();
+        void *mapping = mmap(nullptr,
+                             (size_in_bytes + pageSize - 1) / pageSize * pageSize,
+                             PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                             -1,
+                             0);
+        if (mapping != MAP_FAILED)
+            return Storage(mapping, size_in_bytes, __internal::hugetlb_deleter);
+    }
+#endif
+
+    if (mode != PageMode::SMALL) {
+        return Storage(__internal::mapTransparentHuge(size_in_bytes),
+                       size_in_bytes,
+                       __internal::mapping_deleter);
+    }
+
+    void *mapping = mmap(nullptr,
+                         size_in_bytes,
+                         PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1,
+                         0);
+    if (mapping == MAP_FAILED) throw std::bad_alloc();
+    return Storage(mapping, size_in_bytes, __internal::mapping_deleter);
+}
+
+// Heap storage for small buffers, a transparent huge page mapping for large ones
+inline Storage allocateStorage(std::size_t size_in_bytes) {
+    if (size_in_bytes >= HUGE_PAGE_THRESHOLD)
+        return mapAnonymous(size_in_bytes, PageMode::TRANSPARENT_HUGE);
+    return Storage(size_in_bytes);
+}
+
+// Shared mapping of an open descriptor, the descriptor may be closed afterwards.
+// With READ_WRITE the file is grown to `size_in_bytes` if needed, writes go straight
+// to the file. A READ_ONLY storage must only be read through const access, size 0
+// maps the whole file.
+inline Storage mapFileDescriptor(int fd,
+                                 MappingAccess access = MappingAccess::READ_ONLY,
+                                 std::size_t size_in_bytes = 0) {
+    const bool writable = access == MappingAccess::READ_WRITE;
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+        throw std::system_error(errno, std::generic_category(), "fstat");
+
+    auto fileSize = static_cast<std::size_t>(status.st_size);
+    if (size_in_bytes == 0) size_in_bytes = fileSize;
+    if (writable && size_in_bytes > fileSize && ftruncate(fd, size_in_bytes) != 0)
+        throw std::system_error(errno, std::generic_category(), "ftruncate");
+    if (!writable && size_in_bytes > fileSize)
+        throw std::system_error(EINVAL, std::generic_category(), "mapping past the end");
+
+    if (size_in_bytes == 0) return Storage(nullptr, 0);
+
+    void *mapping = mmap(nullptr,
+                         size_in_bytes,
+                         writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                         MAP_SHARED,
+                         fd,
+                         0);
+    if (mapping == MAP_FAILED)
+        throw std::system_error(errno, std::generic_category(), "mmap");
+
+    return Storage(mapping, size_in_bytes, __internal::mapping_deleter);
+}
+
+// Shared mapping of a file, created if needed with READ_WRITE
+inline Storage mapFile(const std::string &path,
+                       MappingAccess access = MappingAccess::READ_ONLY,
+                       std::size_t size_in_bytes = 0) {
+    int fd = access == MappingAccess::READ_WRITE
+                 ? open(path.c_str(), O_RDWR | O_CREAT, 0644)
+                 : open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), path);
+
+    try {
+        auto storage = mapFileDescriptor(fd, access, size_in_bytes);
+        close(fd);
+        return storage;
+    } catch (std::system_error &error) {
+        close(fd);
+        throw std::system_error(error.code(), path);
+    }
+}
+
+}// namespace memory
+}// namespace hx
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "memory/MappedStorage.hpp"
+#include "memory/Storage.hpp"
+
+namespace hx {
+namespace memory {
+
+enum class NumaPolicy : uint8_t {
+    // pages go to the node of the thread touching them first
+    LOCAL,
+    // pages are spread round robin over all nodes, for data read by every worker
+    INTERLEAVED,
+    // pages are taken only from the given node
+    BIND
+};
+
+namespace __internal {
+// policies from linux/mempolicy.h, mbind is called directly so libnuma is not needed
+constexpr int HX_MPOL_BIND = 2;
+constexpr int HX_MPOL_INTERLEAVE = 3;
+constexpr int HX_MPOL_LOCAL = 4;
+
+inline std::size_t numaNodesImpl() {
+    // "0" or "0-3", ranges other than the first are ignored
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string nodes;
+    if (!(online >> nodes)) return 1;
+
+    auto dash = nodes.find_last_of("-,");
+    return std::stoul(dash == std::string::npos ? nodes : nodes.substr(dash + 1)) + 1;
+}
+}// namespace __internal
+
+inline std::size_t numaNodes() {
+    static const std::size_t nodes = __internal::numaNodesImpl();
+    return nodes;
+}
+
+// Anonymous mapping placed by `policy` before anything touches it. The placement is
+// best effort, kernels without NUMA support leave the default policy in place.
+inline Storage mapNuma(std::size_t size_in_bytes,
+                       NumaPolicy policy,
+                       std::size_t node = 0) {
+    if (policy == NumaPolicy::BIND && node >= numaNodes())
+        throw std::out_of_range("NUMA node " + std::to_string(node) + " is not online");
+
+    auto storage = mapAnonymous(size_in_bytes,
+                                size_in_bytes >= HUGE_PAGE_THRESHOLD
+                                    ? PageMode::TRANSPARENT_HUGE
+                                    : PageMode::SMALL);
+    if (size_in_bytes == 0 || (numaNodes() == 1 && policy != NumaPolicy::BIND))
+        return storage;
+
+    std::vector<unsigned long> mask((numaNodes() + 63) / 64, 0);
+    int mode = __internal::HX_MPOL_LOCAL;
+    if (policy == NumaPolicy::INTERLEAVED) {
+        mode = __internal::HX_MPOL_INTERLEAVE;
+        for (std::size_t i = 0; i < numaNodes(); ++i)
+            mask[i / 64] |= 1ul << (i % 64);
+    } else if (policy == NumaPolicy::BIND) {
+        mode = __internal::HX_MPOL_BIND;
+        mask[node / 64] |= 1ul << (node % 64);
+    }
+
+#ifdef SYS_mbind
+    syscall(SYS_mbind,
+            storage.get(),
+            storage.size(),
+            mode,
+            policy == NumaPolicy::LOCAL ? nullptr : mask.data(),
+            policy == NumaPolicy::LOCAL ? 0ul : mask.size() * 64 + 1,
+            0u);
+#endif
+    return storage;
+}
+
+// Initialises the storage from the pool workers, one page aligned chunk each, so
+// under the LOCAL policy every chunk lands on the node of a worker that reads it.
+// `initialise(offset, begin, end)` gets the index of `begin` within the storage.
+template <typename T, typename Pool, typename Function>
+void parallelFirstTouch(Storage &storage, Pool &pool, Function initialise) {
+    T *data = storage.get_as<T>();
+    const std::size_t size = storage.size_as<T>();
+    const std::size_t elementsPerPage =
+        std::max<std::size_t>(1, getpagesize() / sizeof(T));
+    const std::size_t workers = std::max<std::size_t>(1, pool.size());
+
+    std::size_t chunk = (size + workers - 1) / workers;
+    chunk = (chunk + elementsPerPage - 1) / elementsPerPage * elementsPerPage;
+
+    std::vector<std::future<std::size_t>> touched;
+    for (std::size_t offset = 0; offset < size; offset += chunk) {
+        const std::size_t last = std::min(size, offset + chunk);
+        touched.push_back(pool.async_task([=]() -> std::size_t {
+            initialise(offset, data + offset, data + last);
+            return last - offset;
+        }));
+    }
+
+    for (auto &it : touched)
+        it.get();
+}
+
+}// namespace memory
+}// namespace hx
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <memory_resource>
+
+namespace hx {
+namespace memory {
+
+// Arena, allocations are bumped out of growing chunks and deallocate is a no-op.
+// Everything drawn from it is returned at once by release(), e.g. once per epoch.
+using MonotonicResource = std::pmr::monotonic_buffer_resource;
+
+// Size class pools, freed blocks are kept and handed out again for requests of the
+// same class without going back to the upstream resource
+using PoolResource = std::pmr::synchronized_pool_resource;
+using UnsynchronizedPoolResource = std::pmr::unsynchronized_pool_resource;
+
+}// namespace memory
+}// namespace hx
\ No newline at end of file
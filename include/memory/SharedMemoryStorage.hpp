@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "memory/MappedStorage.hpp"
+#include "memory/Storage.hpp"
+
+namespace hx {
+namespace memory {
+
+enum class SharedMemoryMode : uint8_t {
+    // new segment of the given size, fails if the name is taken
+    CREATE,
+    // existing segment, writable
+    ATTACH,
+    // existing segment, only to be read through const access
+    READ_ONLY
+};
+
+// Storage on a named POSIX shared memory segment (shm_open). Every process mapping the
+// same name sees one physical copy. The segment lives until unlinkSharedMemory(),
+// even after all storages are gone.
+inline Storage mapSharedMemory(const std::string &name,
+                               SharedMemoryMode mode,
+                               std::size_t size_in_bytes = 0) {
+    if (mode == SharedMemoryMode::CREATE && size_in_bytes == 0)
+        throw std::invalid_argument("Cannot create an empty shared memory segment");
+
+    int flags = O_RDWR;
+    if (mode == SharedMemoryMode::CREATE) flags |= O_CREAT | O_EXCL;
+    if (mode == SharedMemoryMode::READ_ONLY) flags = O_RDONLY;
+
+    int fd = shm_open(name.c_str(), flags, 0600);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), name);
+
+    try {
+        auto storage = mapFileDescriptor(fd,
+                                         mode == SharedMemoryMode::READ_ONLY
+                                             ? MappingAccess::READ_ONLY
+                                             : MappingAccess::READ_WRITE,
+                                         size_in_bytes);
+        close(fd);
+        return storage;
+    } catch (std::system_error &error) {
+        close(fd);
+        if (mode == SharedMemoryMode::CREATE) shm_unlink(name.c_str());
+        throw std::system_error(error.code(), name);
+    }
+}
+
+inline void unlinkSharedMemory(const std::string &name) {
+    if (shm_unlink(name.c_str()) != 0 && errno != ENOENT)
+        throw std::system_error(errno, std::generic_category(), name);
+}
+
+// Anonymous memory file (memfd_create) of the given size. The returned descriptor is
+// owned by the caller, it can be inherited by or passed to other processes and
+// mapped there with mapFileDescriptor() or mapFile("/proc/<pid>/fd/<fd>").
+inline int createMemoryFile(const std::string &name, std::size_t size_in_bytes) {
+    int fd = memfd_create(name.c_str(), 0);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), name);
+
+    if (ftruncate(fd, size_in_bytes) != 0) {
+        auto error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), name);
+    }
+    return fd;
+}
+
+}// namespace memory
+}// namespace hx
\ No newline at end of file
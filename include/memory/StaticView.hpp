@@ -0,0 +1,180 @@
+#pragma once
+
+#include <array>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "memory/Storage.hpp"
+#include "memory/Utils.hpp"
+
+namespace hx {
+namespace memory {
+
+constexpr std::size_t DYNAMIC_EXTENT = std::numeric_limits<std::size_t>::max();
+
+// Extents of a StaticView, each either a compile time constant or DYNAMIC_EXTENT.
+// Only the dynamic ones are stored.
+template <std::size_t... StaticExtents>
+class Extents {
+public:
+    constexpr static std::size_t RANK = sizeof...(StaticExtents);
+    constexpr static std::size_t RANK_DYNAMIC =
+        (0 + ... + (StaticExtents == DYNAMIC_EXTENT ? 1 : 0));
+
+    template <typename... DynamicExtents,
+              typename = std::enable_if_t<
+                  sizeof...(DynamicExtents) == RANK_DYNAMIC
+                  && (... && std::is_convertible_v<DynamicExtents, std::size_t>)>>
+    constexpr explicit Extents(DynamicExtents... extents)
+        : _dynamic{static_cast<std::size_t>(extents)...} {}
+
+    template <std::size_t N>
+    constexpr std::size_t extent() const {
+        if constexpr (STATIC[N] == DYNAMIC_EXTENT) {
+            return _dynamic[dynamicIndex(N)];
+        } else {
+            return STATIC[N];
+        }
+    }
+
+    constexpr std::size_t extent(std::size_t n) const {
+        return STATIC[n] == DYNAMIC_EXTENT ? _dynamic[dynamicIndex(n)] : STATIC[n];
+    }
+
+    constexpr static std::size_t staticExtent(std::size_t n) { return STATIC[n]; }
+
+private:
+    constexpr static std::array<std::size_t, RANK> STATIC = {StaticExtents...};
+
+    constexpr static std::size_t dynamicIndex(std::size_t n) {
+        std::size_t index = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            index += STATIC[i] == DYNAMIC_EXTENT;
+        return index;
+    }
+
+    std::array<std::size_t, RANK_DYNAMIC> _dynamic;
+};
+
+// Row major, the last index is contiguous
+struct LayoutRight {
+    template <std::size_t N, typename E>
+    constexpr static std::size_t stride(const E &extents) {
+        if constexpr (N + 1 == E::RANK) {
+            return 1;
+        } else {
+            return extents.template extent<N + 1>() * stride<N + 1>(extents);
+        }
+    }
+};
+
+// Column major, the first index is contiguous
+struct LayoutLeft {
+    template <std::size_t N, typename E>
+    constexpr static std::size_t stride(const E &extents) {
+        if constexpr (N == 0) {
+            return 1;
+        } else {
+            return extents.template extent<N - 1>() * stride<N - 1>(extents);
+        }
+    }
+};
+
+// Row major with rows padded to a multiple of Padding elements, the layout of rule
+// and control point matrices
+template <int Padding>
+struct LayoutPadded {
+    template <std::size_t N, typename E>
+    constexpr static std::size_t stride(const E &extents) {
+        if constexpr (N + 1 == E::RANK) {
+            return 1;
+        } else if constexpr (N + 2 == E::RANK) {
+            return value_padding<Padding>(extents.template extent<N + 1>());
+        } else {
+            return extents.template extent<N + 1>() * stride<N + 1>(extents);
+        }
+    }
+};
+
+// Non owning view with compile time rank and layout. Static extents turn into
+// constants in the offset computation, so loops over them can be fully unrolled
+// and strength reduced; the view itself is usable in constant expressions.
+template <typename T, typename E, typename Layout = LayoutRight>
+class StaticView {
+public:
+    using ExtentsType = E;
+    using LayoutType = Layout;
+
+    template <typename... DynamicExtents,
+              typename = std::enable_if_t<
+                  sizeof...(DynamicExtents) == E::RANK_DYNAMIC
+                  && (... && std::is_convertible_v<DynamicExtents, std::size_t>)>>
+    constexpr StaticView(T *data, DynamicExtents... extents)
+        : _data(data), _extents(extents...) {}
+
+    constexpr StaticView(T *data, const E &extents) : _data(data), _extents(extents) {}
+
+    template <typename... DynamicExtents,
+              typename = std::enable_if_t<
+                  sizeof...(DynamicExtents) == E::RANK_DYNAMIC
+                  && (... && std::is_convertible_v<DynamicExtents, std::size_t>)>>
+    StaticView(hx::memory::Storage *storage, DynamicExtents... extents)
+        : StaticView(storage->get_as<std::remove_const_t<T>>(), extents...) {}
+
+    constexpr static std::size_t rank() { return E::RANK; }
+
+    template <std::size_t N>
+    constexpr std::size_t extent() const {
+        return _extents.template extent<N>();
+    }
+    constexpr std::size_t extent(std::size_t n) const { return _extents.extent(n); }
+
+    template <std::size_t N>
+    constexpr std::size_t stride() const {
+        return Layout::template stride<N>(_extents);
+    }
+
+    constexpr const E &extents() const { return _extents; }
+    constexpr T *data() const { return _data; }
+
+    // number of elements addressed by the view
+    constexpr std::size_t size() const {
+        return this->product(std::make_index_sequence<E::RANK>{});
+    }
+
+    // number of elements spanned in memory, padding included
+    constexpr std::size_t span() const {
+        return this->size() == 0 ? 0 : this->span(std::make_index_sequence<E::RANK>{});
+    }
+
+    template <typename... Indexes,
+              typename = std::enable_if_t<
+                  sizeof...(Indexes) == E::RANK
+                  && (... && std::is_convertible_v<Indexes, std::size_t>)>>
+    constexpr T &operator()(Indexes... indexes) const {
+        return _data[this->offset(std::make_index_sequence<E::RANK>{}, indexes...)];
+    }
+
+private:
+    template <std::size_t... N, typename... Indexes>
+    constexpr std::size_t offset(std::index_sequence<N...>, Indexes... indexes) const {
+        return (0 + ... + (static_cast<std::size_t>(indexes) * this->stride<N>()));
+    }
+
+    template <std::size_t... N>
+    constexpr std::size_t product(std::index_sequence<N...>) const {
+        return (1 * ... * this->extent<N>());
+    }
+
+    template <std::size_t... N>
+    constexpr std::size_t span(std::index_sequence<N...>) const {
+        return (1 + ... + ((this->extent<N>() - 1) * this->stride<N>()));
+    }
+
+    T *_data;
+    E _extents;
+};
+
+}// namespace memory
+}// namespace hx
\ No newline at end of file
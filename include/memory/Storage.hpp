@@ -1,65 +1,117 @@
 #pragma once
 
-#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 #include <cstring>// for memcpy
 
+#include "memory/AllocationTracker.hpp"
+
 namespace hx {
 namespace memory {
 
+template <typename T, std::size_t Dimensions>
+class StorageView;
+
 class Storage {
 public:
+    // plain function pointer, so storing a deleter never allocates. `context` carries
+    // whatever state the deleter needs (memory resource, allocator copy, ...)
+    using Deleter = void (*)(void *context,
+                             void *p,
+                             std::size_t size,
+                             std::size_t alignment) noexcept;
+
     Storage(std::size_t size_in_bytes)
-        : _size_in_bytes(size_in_bytes), _deleter(Storage::default_deleter) {
+        : _size_in_bytes(size_in_bytes)
+        , _alignment(alignof(std::max_align_t))
+        , _deleter(Storage::default_deleter) {
         this->_context = static_cast<void *>(new unsigned char[size_in_bytes]);
     }
 
-    template <typename Allocator>
+    template <typename Allocator,
+              typename = std::enable_if_t<!std::is_pointer_v<Allocator>>>
     Storage(std::size_t size_in_bytes, Allocator allocator)
-        : _size_in_bytes(size_in_bytes) {
-        this->_deleter = [allocator](void *p, std::size_t size) mutable -> void {
-            allocator.deallocate(reinterpret_cast<typename Allocator::pointer>(p), size);
-        };
-        this->_context = static_cast<void *>(allocator.allocate(
-            1 + (_size_in_bytes - 1) / sizeof(typename Allocator::value_type)));
+        : _size_in_bytes(size_in_bytes)
+        , _alignment(alignof(typename Allocator::value_type)) {
+        this->_context = static_cast<void *>(
+            allocator.allocate(Storage::elements_of<Allocator>(_size_in_bytes)));
+
+        // stateless allocators are rebuilt in the deleter, anything else keeps a copy
+        if constexpr (std::is_empty_v<Allocator>) {
+            this->_deleter = Storage::allocator_deleter<Allocator>;
+        } else {
+            this->_deleter = Storage::stateful_allocator_deleter<Allocator>;
+            this->_deleterContext = new Allocator(std::move(allocator));
+        }
+    }
+
+    // Draws the storage from a memory resource (arena, pool, ...), the resource has
+    // to outlive the storage
+    Storage(std::size_t size_in_bytes,
+            std::pmr::memory_resource *resource,
+            std::size_t alignment = alignof(std::max_align_t))
+        : _size_in_bytes(size_in_bytes)
+        , _alignment(alignment)
+        , _deleter(Storage::resource_deleter)
+        , _deleterContext(resource) {
+        this->_context = resource->allocate(size_in_bytes, alignment);
     }
 
     Storage(void *ptr,
             std::size_t size_in_bytes,
-            std::function<void(void *, std::size_t)> deleter =
-                hx::memory::Storage::default_deleter)
-        : _context(ptr), _size_in_bytes(size_in_bytes), _deleter(deleter) {}
+            Deleter deleter = hx::memory::Storage::default_deleter,
+            void *deleterContext = nullptr)
+        : _context(ptr)
+        , _size_in_bytes(size_in_bytes)
+        , _deleter(deleter)
+        , _deleterContext(deleterContext) {}
 
-    ~Storage() {
-        if (this->_context) this->_deleter(this->_context, this->_size_in_bytes);
-    }
+    ~Storage() { this->release(); }
 
     Storage(const Storage &) = delete;
     Storage &operator=(Storage &) = delete;
 
     Storage(Storage &&rhs) {
         this->_context = rhs._context;
-        this->_deleter = rhs._deleter;
         this->_size_in_bytes = rhs._size_in_bytes;
+        this->_alignment = rhs._alignment;
+        this->_deleter = rhs._deleter;
+        this->_deleterContext = rhs._deleterContext;
 
         rhs._context = 0;
     }
 
     Storage &operator=(Storage &&rhs) {
+        if (this == &rhs) return *this;
+        this->release();
+
         this->_context = rhs._context;
-        this->_deleter = rhs._deleter;
         this->_size_in_bytes = rhs._size_in_bytes;
+        this->_alignment = rhs._alignment;
+        this->_deleter = rhs._deleter;
+        this->_deleterContext = rhs._deleterContext;
 
         rhs._context = 0;
 
         return *this;
     }
 
-    void *get() { return this->_context; }
+    // Non const access is a write, a storage sharing its buffer detaches first
+    void *get() {
+        this->detach();
+        return this->_context;
+    }
 
     template <typename T>
     T *get_as() {
+        this->detach();
         return static_cast<T *>(this->_context);
     }
 
@@ -69,19 +121,113 @@ public:
     }
 
     std::size_t size() const { return _size_in_bytes; }
+    std::size_t alignment() const { return _alignment; }
 
-    template <typename Allocator>
+    // resource the storage was drawn from, nullptr for allocator or raw storages
+    std::pmr::memory_resource *resource() const {
+        auto [deleter, context] = this->origin();
+        return deleter == Storage::resource_deleter
+                   ? static_cast<std::pmr::memory_resource *>(context)
+                   : nullptr;
+    }
+
+    // Counts the buffer against `counters` until it is released. Copies and detached
+    // buffers are counted against the same counters. A shared buffer is counted once,
+    // for all its owners.
+    Storage &track(AllocationCounters &counters) {
+        if (!this->_context) return *this;
+
+        counters.allocated(this->_size_in_bytes);
+
+        // sharing stays the outer layer, so isShared() and detach() still see it and
+        // the bytes are released with the last owner
+        Deleter *deleter = &this->_deleter;
+        void **context = &this->_deleterContext;
+        if (this->_deleter == Storage::shared_deleter) {
+            auto *shared = static_cast<SharedState *>(this->_deleterContext);
+            deleter = &shared->deleter;
+            context = &shared->deleterContext;
+        }
+
+        *context = new TrackedState{&counters, *deleter, *context};
+        *deleter = Storage::tracked_deleter;
+        return *this;
+    }
+
+    // counters the storage is tracked by, nullptr if it is not
+    AllocationCounters *counters() const {
+        auto deleter = this->_deleter;
+        auto *context = this->_deleterContext;
+        while (true) {
+            if (deleter == Storage::tracked_deleter)
+                return static_cast<const TrackedState *>(context)->counters;
+            if (deleter != Storage::shared_deleter) return nullptr;
+
+            auto *shared = static_cast<const SharedState *>(context);
+            deleter = shared->deleter;
+            context = shared->deleterContext;
+        }
+    }
+
+    // Copy on write: the returned storage shares the buffer until either side asks
+    // for non const access. Sharing the same storage from several threads at once is
+    // not safe the first time, as it converts the storage into the shared mode.
+    // A writable StorageView keeps its pointer, so a storage is not shared while one
+    // is alive over it: the writes would reach every owner.
+    Storage share() const {
+        if (this->_views > 0)
+            throw std::logic_error("Storage with live writable views cannot be shared");
+        if (!this->_context) return Storage(nullptr, 0);
+
+        if (this->_deleter != Storage::shared_deleter) {
+            this->_deleterContext =
+                new SharedState{{1}, this->_deleter, this->_deleterContext};
+            this->_deleter = Storage::shared_deleter;
+        }
+        static_cast<SharedState *>(this->_deleterContext)
+            ->references.fetch_add(1, std::memory_order_relaxed);
+
+        Storage shared(this->_context,
+                       this->_size_in_bytes,
+                       Storage::shared_deleter,
+                       this->_deleterContext);
+        shared._alignment = this->_alignment;
+        return shared;
+    }
+
+    bool isShared() const {
+        return this->_deleter == Storage::shared_deleter
+               && static_cast<const SharedState *>(this->_deleterContext)
+                          ->references.load(std::memory_order_acquire)
+                      > 1;
+    }
+
+    template <typename Allocator,
+              typename = std::enable_if_t<!std::is_pointer_v<Allocator>>>
     Storage copy(Allocator allocator) const {
         Storage copy(this->_size_in_bytes, allocator);
         memcpy(copy._context, this->_context, this->_size_in_bytes);
 
+        copy.trackLike(*this);
         return copy;
     }
 
+    Storage copy(std::pmr::memory_resource *resource) const {
+        Storage copy(this->_size_in_bytes, resource, this->_alignment);
+        memcpy(copy._context, this->_context, this->_size_in_bytes);
+
+        copy.trackLike(*this);
+        return copy;
+    }
+
+    // resource backed storages are copied into the same resource
     Storage copy() const {
+        if (auto *resource = this->resource()) return this->copy(resource);
+
         Storage copy(this->_size_in_bytes);
         memcpy(copy._context, this->_context, this->_size_in_bytes);
 
+        copy.trackLike(*this);
         return copy;
     }
 
@@ -90,15 +236,141 @@ public:
         return _size_in_bytes / sizeof(T);
     }
 
-    static void default_deleter(void *p, std::size_t) noexcept {
+    static void default_deleter(void *, void *p, std::size_t, std::size_t) noexcept {
         delete[] static_cast<unsigned char *>(p);
     }
 
 private:
+    // detached copies of storages not drawn from a resource are cache line aligned
+    constexpr static std::size_t DETACHED_ALIGNMENT = 64;
+
+    struct SharedState {
+        std::atomic<std::size_t> references;
+        Deleter deleter;
+        void *deleterContext;
+    };
+
+    struct TrackedState {
+        AllocationCounters *counters;
+        Deleter deleter;
+        void *deleterContext;
+    };
+
+    template <typename Allocator>
+    static std::size_t elements_of(std::size_t size_in_bytes) noexcept {
+        return 1 + (size_in_bytes - 1) / sizeof(typename Allocator::value_type);
+    }
+
+    template <typename Allocator>
+    static void allocator_deleter(void *,
+                                  void *p,
+                                  std::size_t size,
+                                  std::size_t) noexcept {
+        Allocator allocator;
+        allocator.deallocate(static_cast<typename Allocator::value_type *>(p),
+                             elements_of<Allocator>(size));
+    }
+
+    template <typename Allocator>
+    static void stateful_allocator_deleter(void *context,
+                                           void *p,
+                                           std::size_t size,
+                                           std::size_t) noexcept {
+        auto *allocator = static_cast<Allocator *>(context);
+        allocator->deallocate(static_cast<typename Allocator::value_type *>(p),
+                              elements_of<Allocator>(size));
+        delete allocator;
+    }
+
+    static void resource_deleter(void *context,
+                                 void *p,
+                                 std::size_t size,
+                                 std::size_t alignment) noexcept {
+        static_cast<std::pmr::memory_resource *>(context)->deallocate(p, size, alignment);
+    }
+
+    static void shared_deleter(void *context,
+                               void *p,
+                               std::size_t size,
+                               std::size_t alignment) noexcept {
+        auto *shared = static_cast<SharedState *>(context);
+        if (shared->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            shared->deleter(shared->deleterContext, p, size, alignment);
+            delete shared;
+        }
+    }
+
+    static void tracked_deleter(void *context,
+                                void *p,
+                                std::size_t size,
+                                std::size_t alignment) noexcept {
+        auto *tracked = static_cast<TrackedState *>(context);
+        tracked->counters->released(size);
+        tracked->deleter(tracked->deleterContext, p, size, alignment);
+        delete tracked;
+    }
+
+    // deleter and context of the allocation itself, below sharing and tracking
+    std::pair<Deleter, void *> origin() const {
+        auto deleter = this->_deleter;
+        auto *context = this->_deleterContext;
+        while (deleter == Storage::shared_deleter
+               || deleter == Storage::tracked_deleter) {
+            if (deleter == Storage::shared_deleter) {
+                auto *shared = static_cast<const SharedState *>(context);
+                deleter = shared->deleter;
+                context = shared->deleterContext;
+            } else {
+                auto *tracked = static_cast<const TrackedState *>(context);
+                deleter = tracked->deleter;
+                context = tracked->deleterContext;
+            }
+        }
+        return {deleter, context};
+    }
+
+    void trackLike(const Storage &other) {
+        if (auto *counters = other.counters()) this->track(*counters);
+    }
+
+    void detach() {
+        if (!this->isShared()) return;
+
+        auto *resource = this->resource();
+        auto alignment = this->_alignment;
+        if (!resource) {
+            resource = std::pmr::new_delete_resource();
+            alignment = std::max(alignment, DETACHED_ALIGNMENT);
+        }
+
+        Storage detached(this->_size_in_bytes, resource, alignment);
+        memcpy(detached._context, this->_context, this->_size_in_bytes);
+        detached.trackLike(*this);
+        *this = std::move(detached);
+    }
+
+    void release() noexcept {
+        if (this->_context)
+            this->_deleter(this->_deleterContext,
+                           this->_context,
+                           this->_size_in_bytes,
+                           this->_alignment);
+        this->_context = nullptr;
+    }
+
     void *_context;
     std::size_t _size_in_bytes;
-    std::function<void(void *, std::size_t)> _deleter;
+    std::size_t _alignment = 1;
+    // mutable, share() turns a const storage into the shared mode
+    mutable Deleter _deleter;
+    mutable void *_deleterContext = nullptr;
+
+    // writable StorageViews alive over this object, they stay with it when it is
+    // moved from
+    template <typename, std::size_t>
+    friend class StorageView;
+    std::size_t _views = 0;
 };
 
 }// namespace memory
-}// namespace hx
+}// namespace hx
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <type_traits>
+#include <utility>
 
 #include "memory/Storage.hpp"
 #include "memory/View.hpp"
@@ -8,13 +10,18 @@
 namespace hx {
 namespace memory {
 
+// View over a Storage. The buffer is looked up, and a shared storage detached by a
+// writable view, when the view is built. A writable view keeps the storage from being
+// shared while it is alive, so its pointer never aliases a buffer other owners see.
 template <typename T, std::size_t Dimensions>
 class StorageView : public hx::memory::View<T, Dimensions> {
 public:
     StorageView(hx::memory::Storage *storage,
                 const std::array<std::size_t, Dimensions> &strides,
                 const std::array<std::size_t, Dimensions> &sizes)
-        : View<T, Dimensions>(storage->get_as<T>(), strides, sizes), _storage(storage) {}
+        : View<T, Dimensions>(lookup(storage), strides, sizes), _storage(storage) {
+        this->registerView();
+    }
 
     StorageView(hx::memory::Storage *storage,
                 const std::array<std::size_t, Dimensions> &sizes)
@@ -27,10 +34,41 @@ public:
     StorageView(hx::memory::Storage *storage, DimsValues... dims)
         : StorageView(storage, {static_cast<std::size_t>(dims)...}) {}
 
+    StorageView(const StorageView &rhs)
+        : View<T, Dimensions>(rhs), _storage(rhs._storage) {
+        this->registerView();
+    }
+
+    StorageView &operator=(const StorageView &rhs) {
+        if (this == &rhs) return *this;
+        this->unregisterView();
+        View<T, Dimensions>::operator=(rhs);
+        this->_storage = rhs._storage;
+        this->registerView();
+        return *this;
+    }
+
+    ~StorageView() { this->unregisterView(); }
+
     hx::memory::Storage &getStorage() { return *(this->_storage); }
     const hx::memory::Storage &getStorage() const { return *(this->_storage); }
 
 private:
+    // views of const elements only read, they leave a shared storage shared
+    static T *lookup(hx::memory::Storage *storage) {
+        if constexpr (std::is_const_v<T>)
+            return std::as_const(*storage).template get_as<T>();
+        else
+            return storage->get_as<T>();
+    }
+
+    void registerView() {
+        if constexpr (!std::is_const_v<T>) ++this->_storage->_views;
+    }
+    void unregisterView() {
+        if constexpr (!std::is_const_v<T>) --this->_storage->_views;
+    }
+
     hx::memory::Storage *_storage;
 };
 
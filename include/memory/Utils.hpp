@@ -35,9 +35,12 @@ class SmallLookupBimap {
 public:
     SmallLookupBimap(std::size_t bimapSize)
         : _lookupBimap1(bimapSize), _lookupBimap2(bimapSize){};
+    SmallLookupBimap(std::size_t fromSize, std::size_t toSize)
+        : _lookupBimap1(fromSize), _lookupBimap2(toSize){};
 
     std::size_t to(std::size_t from) const { return _lookupBimap1[from]; }
     std::size_t from(std::size_t to) const { return _lookupBimap2[to]; }
+    std::size_t size() const { return _lookupBimap2.size(); }
 
     void addPair(std::size_t from, std::size_t to) {
         _lookupBimap1[from] = to;
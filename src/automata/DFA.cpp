@@ -1,8 +1,84 @@
 #include "automata/DFA.hpp"
 #include "automata/TransitionFunction.hpp"
 
+#include <algorithm>
+#include <unordered_map>
+
 namespace hx {
 
+namespace {
+// dense tables below this size stay in L2, where a single load is on par with the
+// compressed lookup however much memory compression would save
+constexpr std::size_t DENSE_TABLE_CACHE_BUDGET = 1 << 20;
+constexpr std::size_t COMB_SEARCH_WINDOW = 1024;
+
+std::size_t DFACheckedTransition(hx::TransitionFunction *src,
+                                 std::size_t state,
+                                 std::size_t action) {
+    try {
+        return src->get(state, action);
+    } catch (std::out_of_range &) {
+        return DFA::INVALID_STATE;
+    }
+}
+
+// Dense table whose row i holds state order[i], wrapped so callers keep original ids
+hx::TransitionFunction *DFACreateRenumberedTable(hx::TransitionFunction *src,
+                                                 std::size_t numberOfStates,
+                                                 std::size_t numberOfActions,
+                                                 const std::vector<std::size_t> &order) {
+    hx::memory::SmallLookupBimap bimapStates(numberOfStates, order.size());
+    hx::memory::SmallLookupBimap bimapActions(numberOfActions);
+
+    for (std::size_t i = 0; i < numberOfActions; ++i)
+        bimapActions.addPair(i, i);
+
+    for (std::size_t i = 0; i < order.size(); ++i)
+        bimapStates.addPair(order[i], i);
+
+    std::unique_ptr<hx::TransitionFunctionTable> newTransitionTable =
+        std::make_unique<hx::TransitionFunctionTable>(order.size(), numberOfActions);
+
+    for (std::size_t state = 0; state < order.size(); ++state) {
+        for (std::size_t action = 0; action < numberOfActions; ++action) {
+            auto transform = DFACheckedTransition(src, order[state], action);
+            newTransitionTable->set(state,
+                                    action,
+                                    transform < numberOfStates ? bimapStates.to(transform)
+                                                               : DFA::INVALID_STATE);
+        }
+    }
+
+    return new TransitionFunctionTableIndirect(
+        std::move(newTransitionTable), bimapStates, bimapActions);
+}
+}// namespace
+
+std::vector<char> DFAAccessibleStates(hx::TransitionFunction *src,
+                                      std::size_t numberOfStates,
+                                      std::size_t numberOfActions,
+                                      std::size_t startState) {
+    std::vector<char> isAccessible(numberOfStates, 0);
+    std::queue<std::size_t> q;
+
+    q.push(startState);
+    isAccessible[startState] = 1;
+    while (!q.empty()) {
+        auto current = q.front();
+        q.pop();
+
+        for (std::size_t i = 0; i < numberOfActions; ++i) {
+            auto transform = DFACheckedTransition(src, current, i);
+            if (transform < numberOfStates && !isAccessible[transform]) {
+                isAccessible[transform] = 1;
+                q.push(transform);
+            }
+        }
+    }
+
+    return isAccessible;
+}
+
 hx::TransitionFunction *DFACompileToDynamicTable(hx::TransitionFunction *src,
                                                  std::size_t numberOfStates,
                                                  std::size_t numberOfActions) {
@@ -29,46 +105,497 @@ hx::TransitionFunction *DFACompileToReducedTable(hx::TransitionFunction *src,
                                                  std::size_t numberOfStates,
                                                  std::size_t numberOfActions,
                                                  std::size_t startState) {
-    std::vector<char> isAccessible(numberOfStates, 0);
-    std::queue<std::size_t> q;
-
-    q.push(startState);
-    while (!q.empty()) {
-        auto current = q.front();
-        q.pop();
+    auto isAccessible =
+        DFAAccessibleStates(src, numberOfStates, numberOfActions, startState);
 
-        isAccessible[current] = 1;
-        for (std::size_t i = 0; i < numberOfActions; ++i) {
-            try {
-                auto transform = src->get(current, i);
-                if (transform != DFA::INVALID_STATE && !isAccessible[transform])
-                    q.push(transform);
-            } catch (std::out_of_range &) {
-            }
-        }
+    std::vector<std::size_t> order;
+    for (std::size_t f = 0; f < numberOfStates; f++) {
+        if (isAccessible[f]) order.push_back(f);
     }
 
-    auto accessibleNodes = std::accumulate(isAccessible.begin(), isAccessible.end(), 0ul);
-    hx::memory::SmallLookupBimap bimapStates(accessibleNodes);
-    hx::memory::SmallLookupBimap bimapActions(numberOfActions);
+    return DFACreateRenumberedTable(src, numberOfStates, numberOfActions, order);
+}
 
-    for (std::size_t i = 0; i < numberOfActions; ++i)
-        bimapActions.addPair(i, i);
+hx::TransitionFunction *DFACompileToShuffleTable(hx::TransitionFunction *src,
+                                                 std::size_t numberOfStates,
+                                                 std::size_t numberOfActions,
+                                                 std::size_t startState) {
+    if (numberOfActions > TransitionFunctionShuffle::ALPHABET_SIZE) return nullptr;
+
+    auto isAccessible =
+        DFAAccessibleStates(src, numberOfStates, numberOfActions, startState);
+    auto accessibleNodes = std::accumulate(isAccessible.begin(), isAccessible.end(), 0ul);
+    if (accessibleNodes > TransitionFunctionShuffle::MAX_STATES) return nullptr;
 
+    hx::memory::SmallLookupBimap bimapStates(numberOfStates, accessibleNodes);
     for (std::size_t f = 0, s = 0; f < numberOfStates; f++) {
         if (isAccessible[f]) bimapStates.addPair(f, s++);
     }
 
-    std::unique_ptr<hx::TransitionFunctionTable> newTransitionTable =
-        std::make_unique<hx::TransitionFunctionTable>(accessibleNodes, numberOfActions);
+    std::unique_ptr<hx::TransitionFunctionShuffle> result =
+        std::make_unique<hx::TransitionFunctionShuffle>(bimapStates);
 
     for (std::size_t state = 0; state < accessibleNodes; ++state) {
         auto originalState = bimapStates.from(state);
+        for (std::size_t action = 0; action < numberOfActions; ++action) {
+            auto transform = DFACheckedTransition(src, originalState, action);
+
+            // all 16 lanes are taken, so there is no room left for the sink lane
+            if (transform >= numberOfStates) {
+                if (accessibleNodes == TransitionFunctionShuffle::MAX_STATES)
+                    return nullptr;
+                continue;
+            }
+            result->set(state, action, bimapStates.to(transform));
+        }
+    }
+
+    return result.release();
+}
+
+hx::TransitionFunction *DFACompileToCompressedTable(hx::TransitionFunction *src,
+                                                    std::size_t numberOfStates,
+                                                    std::size_t numberOfActions,
+                                                    std::size_t memoryBudget) {
+    using Compressed = hx::TransitionFunctionTableCompressed;
+    using Exception = std::pair<std::uint32_t, std::uint32_t>;
+    if (numberOfStates >= Compressed::INVALID_STATE) return nullptr;
+
+    std::vector<std::uint32_t> rowOfState(numberOfStates);
+    std::vector<std::uint32_t> defaults;
+    std::vector<std::size_t> exceptionOffsets = {0};
+    std::vector<Exception> exceptions;
+    std::unordered_multimap<std::size_t, std::uint32_t> rowsByHash;
+
+    std::vector<std::uint32_t> row(numberOfActions), sorted(numberOfActions);
+    for (std::size_t state = 0; state < numberOfStates; ++state) {
+        for (std::size_t action = 0; action < numberOfActions; ++action) {
+            auto transform = DFACheckedTransition(src, state, action);
+            row[action] = transform < numberOfStates ? static_cast<std::uint32_t>(transform)
+                                                     : Compressed::INVALID_STATE;
+        }
+
+        // the most common target becomes the default, ties go to the smallest one
+        std::copy(row.begin(), row.end(), sorted.begin());
+        std::sort(sorted.begin(), sorted.end());
+        std::uint32_t defaultState = Compressed::INVALID_STATE;
+        for (std::size_t i = 0, best = 0; i < sorted.size();) {
+            auto j = i;
+            while (j < sorted.size() && sorted[j] == sorted[i])
+                ++j;
+            if (j - i > best) {
+                best = j - i;
+                defaultState = sorted[i];
+            }
+            i = j;
+        }
+
+        auto first = exceptions.size();
+        std::size_t hash = defaultState;
+        for (std::size_t action = 0; action < numberOfActions; ++action) {
+            if (row[action] == defaultState) continue;
+            exceptions.emplace_back(action, row[action]);
+            hash ^= ((action << 32) | row[action]) + 0x9e3779b97f4a7c15ul + (hash << 6)
+                    + (hash >> 2);
+        }
+
+        auto candidates = rowsByHash.equal_range(hash);
+        auto duplicate = std::find_if(candidates.first, candidates.second, [&](auto &it) {
+            auto r = it.second;
+            return defaults[r] == defaultState
+                   && std::equal(exceptions.begin() + exceptionOffsets[r],
+                                 exceptions.begin() + exceptionOffsets[r + 1],
+                                 exceptions.begin() + first,
+                                 exceptions.end());
+        });
+
+        if (duplicate != candidates.second) {
+            exceptions.resize(first);
+            rowOfState[state] = duplicate->second;
+        } else {
+            rowOfState[state] = defaults.size();
+            rowsByHash.emplace(hash, defaults.size());
+            defaults.push_back(defaultState);
+            exceptionOffsets.push_back(exceptions.size());
+        }
+    }
+
+    // even a perfect comb needs every exception once, no point packing past the budget
+    auto minimalSize = sizeof(std::uint32_t)
+                       * (rowOfState.size() + 2 * defaults.size() + 2 * exceptions.size());
+    if (minimalSize > memoryBudget) return nullptr;
+
+    // comb packing, rows with the most exceptions are placed first
+    std::vector<std::uint32_t> order(defaults.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+        return exceptionOffsets[a + 1] - exceptionOffsets[a]
+               > exceptionOffsets[b + 1] - exceptionOffsets[b];
+    });
+
+    std::vector<std::uint32_t> bases(defaults.size(), 0);
+    std::vector<std::uint32_t> next, check;
+    std::size_t firstFree = 0;
+    for (auto r : order) {
+        auto begin = exceptions.begin() + exceptionOffsets[r];
+        auto end = exceptions.begin() + exceptionOffsets[r + 1];
+        if (begin == end) break;
+
+        // first fit over a bounded window, rows that do not fit go past the end
+        auto fits = [&](std::size_t base) {
+            return std::all_of(begin, end, [&](const Exception &e) {
+                return base + e.first >= check.size()
+                       || check[base + e.first] == Compressed::INVALID_STATE;
+            });
+        };
+
+        std::size_t base = check.size();
+        auto position = std::max<std::size_t>(firstFree, begin->first);
+        for (auto last = position + COMB_SEARCH_WINDOW;
+             position < last && position - begin->first < check.size();
+             ++position) {
+            if (fits(position - begin->first)) {
+                base = position - begin->first;
+                break;
+            }
+        }
+
+        auto required = base + (end - 1)->first + 1;
+        if (required > check.size()) {
+            check.resize(required, Compressed::INVALID_STATE);
+            next.resize(required, Compressed::INVALID_STATE);
+        }
+        for (auto it = begin; it != end; ++it) {
+            check[base + it->first] = r;
+            next[base + it->first] = it->second;
+        }
+        bases[r] = base;
+
+        while (firstFree < check.size() && check[firstFree] != Compressed::INVALID_STATE)
+            ++firstFree;
+    }
+
+    return new Compressed(std::move(rowOfState),
+                          std::move(defaults),
+                          std::move(bases),
+                          std::move(next),
+                          std::move(check));
+}
+
+// Chooses between a dense and a compressed table. The dense one is kept while it
+// fits the cache budget, past that the compressed one wins as soon as it is smaller.
+// Its extra lookups cost nothing there: the sparse automata of benchmark_automata
+// (256 symbols, 4 to 128 exceptions per state, dense tables of 2 to 128 MiB) ran
+// the compressed table at 0.17 to 0.93 of the dense time per symbol on x86-64, the
+// default path is predicted and does not wait for the table. Within the budget the
+// two were even (0.65 to 1.32), so the dense table stays.
+hx::TransitionFunction *DFACompileToCompactTable(hx::TransitionFunction *src,
+                                                 std::size_t numberOfStates,
+                                                 std::size_t numberOfActions) {
+    if (src->getType() == TransitionType::SHUFFLE
+        || src->getType() == TransitionType::COMPRESSED)
+        return src;
+
+    auto denseSize = sizeof(std::size_t) * numberOfStates * numberOfActions;
+    if (denseSize > DENSE_TABLE_CACHE_BUDGET) {
+        std::unique_ptr<hx::TransitionFunction> compressed(DFACompileToCompressedTable(
+            src, numberOfStates, numberOfActions, denseSize));
+        if (compressed && compressed->memorySize() < denseSize)
+            return compressed.release();
+    }
+
+    return DFACompileToDynamicTable(src, numberOfStates, numberOfActions);
+}
+
+// Greedy chain layout: starting from the hottest unplaced state, keep following the
+// most frequent transition into an unplaced state, so hot paths end up in
+// neighbouring rows. States never visited keep their relative order at the end.
+// With `isAccessible` the states it does not mark are left out.
+std::vector<std::size_t> DFAProfiledStateOrder(hx::TransitionFunction *src,
+                                               std::size_t numberOfStates,
+                                               const hx::DFAProfile &profile,
+                                               const std::vector<char> *isAccessible) {
+    const auto &visits = profile.getVisitHistogram();
+
+    std::vector<std::vector<std::pair<std::size_t, std::size_t>>> successors(
+        numberOfStates);
+    for (const auto &it : profile.getTransitionCounts()) {
+        auto transform = DFACheckedTransition(src, it.first.first, it.first.second);
+        if (transform < numberOfStates && transform != it.first.first)
+            successors[it.first.first].emplace_back(it.second, transform);
+    }
+    for (auto &stateSuccessors : successors)
+        std::sort(stateSuccessors.rbegin(), stateSuccessors.rend());
+
+    std::vector<std::size_t> byVisits(numberOfStates);
+    std::iota(byVisits.begin(), byVisits.end(), 0);
+    std::stable_sort(byVisits.begin(), byVisits.end(), [&](auto a, auto b) {
+        return visits[a] > visits[b];
+    });
+
+    std::vector<std::size_t> order;
+    std::vector<char> isPlaced(numberOfStates, 0);
+    if (isAccessible) {
+        for (std::size_t state = 0; state < numberOfStates; ++state)
+            isPlaced[state] = !(*isAccessible)[state];
+    }
+    order.reserve(numberOfStates);
+    for (auto state : byVisits) {
+        while (!isPlaced[state]) {
+            isPlaced[state] = 1;
+            order.push_back(state);
+
+            for (const auto &successor : successors[state]) {
+                if (!isPlaced[successor.second]) {
+                    state = successor.second;
+                    break;
+                }
+            }
+        }
+    }
+
+    return order;
+}
+
+hx::TransitionFunction *DFACompileToProfiledTable(hx::TransitionFunction *src,
+                                                  std::size_t numberOfStates,
+                                                  std::size_t numberOfActions,
+                                                  const hx::DFAProfile &profile,
+                                                  std::size_t startState) {
+    if (src->getType() == TransitionType::SHUFFLE) return src;
+
+    // a starting state asks for the states it cannot reach to be dropped
+    std::vector<char> isAccessible;
+    if (startState < numberOfStates)
+        isAccessible =
+            DFAAccessibleStates(src, numberOfStates, numberOfActions, startState);
+
+    return DFACreateRenumberedTable(
+        src,
+        numberOfStates,
+        numberOfActions,
+        DFAProfiledStateOrder(src,
+                              numberOfStates,
+                              profile,
+                              isAccessible.empty() ? nullptr : &isAccessible));
+}
+
+// Moore partition refinement over the reachable states. Every class keeps one
+// representative as its external id, the starting state represents its own class.
+// A round hashes the signature of every state (its class and the classes it moves
+// to) into a flat array and sorts the states by it; only states with equal hashes
+// are compared symbol by symbol. Memory stays linear in the states besides the
+// 32 bit copy of the transitions.
+hx::TransitionFunction *DFACompileToMinimalTable(hx::TransitionFunction *src,
+                                                 std::size_t numberOfStates,
+                                                 std::size_t numberOfActions,
+                                                 std::size_t startState,
+                                                 const std::vector<char> &finalStates) {
+    auto isAccessible =
+        DFAAccessibleStates(src, numberOfStates, numberOfActions, startState);
+
+    std::vector<std::size_t> states;
+    std::vector<std::size_t> localState(numberOfStates, 0);
+    for (std::size_t f = 0; f < numberOfStates; f++) {
+        if (!isAccessible[f]) continue;
+        localState[f] = states.size();
+        states.push_back(f);
+    }
+    if (states.size() >= std::numeric_limits<std::uint32_t>::max())
+        throw std::length_error("Too many states to minimise");
+
+    // local index states.size() is the sink of undefined transitions, it loops on
+    // itself, starts in its own class and never merges with a real state
+    const std::size_t sink = states.size();
+    const std::size_t localStates = states.size() + 1;
+    std::vector<std::uint32_t> transitions(localStates * numberOfActions, sink);
+    for (std::size_t state = 0; state < states.size(); ++state) {
+        for (std::size_t action = 0; action < numberOfActions; ++action) {
+            auto transform = DFACheckedTransition(src, states[state], action);
+            if (transform < numberOfStates)
+                transitions[state * numberOfActions + action] = localState[transform];
+        }
+    }
+
+    std::vector<std::uint32_t> classes(localStates);
+    for (std::size_t state = 0; state < states.size(); ++state)
+        classes[state] = finalStates[states[state]] ? 1 : 0;
+    classes[sink] = 2;
+
+    auto sameSignature = [&](std::size_t a, std::size_t b) {
+        if (classes[a] != classes[b]) return false;
+        const auto *nextA = transitions.data() + a * numberOfActions;
+        const auto *nextB = transitions.data() + b * numberOfActions;
         for (std::size_t action = 0; action < numberOfActions; ++action)
-            newTransitionTable->set(state, action, src->get(originalState, action));
+            if (classes[nextA[action]] != classes[nextB[action]]) return false;
+        return true;
+    };
+
+    std::vector<std::uint64_t> hashes(localStates);
+    std::vector<std::uint32_t> order(localStates);
+    std::vector<std::uint32_t> refined(localStates);
+    std::vector<std::uint32_t> runClasses;
+    for (std::size_t numberOfClasses = 0;;) {
+        for (std::size_t state = 0; state < localStates; ++state) {
+            std::uint64_t hash = classes[state] + 1;
+            const auto *next = transitions.data() + state * numberOfActions;
+            for (std::size_t action = 0; action < numberOfActions; ++action) {
+                hash = (hash ^ (classes[next[action]] + 1)) * 0x9e3779b97f4a7c15ul;
+                hash ^= hash >> 29;
+            }
+            hashes[state] = hash;
+        }
+
+        std::iota(order.begin(), order.end(), std::uint32_t(0));
+        std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+            return hashes[a] < hashes[b];
+        });
+
+        // a run of equal hashes is nearly always one class, collisions get their own
+        std::uint32_t refinedClasses = 0;
+        for (std::size_t first = 0; first < localStates;) {
+            std::size_t last = first;
+            while (last < localStates && hashes[order[last]] == hashes[order[first]])
+                ++last;
+
+            runClasses.clear();
+            for (std::size_t i = first; i < last; ++i) {
+                const auto state = order[i];
+                auto found = std::find_if(
+                    runClasses.begin(),
+                    runClasses.end(),
+                    [&](std::uint32_t other) { return sameSignature(state, other); });
+                if (found == runClasses.end()) {
+                    runClasses.push_back(state);
+                    refined[state] = refinedClasses++;
+                } else {
+                    refined[state] = refined[*found];
+                }
+            }
+            first = last;
+        }
+
+        classes.swap(refined);
+        if (refinedClasses == numberOfClasses) break;
+        numberOfClasses = refinedClasses;
+    }
+
+    // dense class ids without the sink, in order of the first member
+    std::vector<std::size_t> classIds(states.size() + 1, DFA::INVALID_STATE);
+    std::vector<std::size_t> representatives;
+    for (std::size_t state = 0; state < states.size(); ++state) {
+        auto &id = classIds[classes[state]];
+        if (id == DFA::INVALID_STATE) {
+            id = representatives.size();
+            representatives.push_back(state);
+        }
+    }
+    representatives[classIds[classes[localState[startState]]]] = localState[startState];
+
+    hx::memory::SmallLookupBimap bimapStates(numberOfStates, representatives.size());
+    hx::memory::SmallLookupBimap bimapActions(numberOfActions);
+    for (std::size_t i = 0; i < numberOfActions; ++i)
+        bimapActions.addPair(i, i);
+    for (std::size_t state = 0; state < states.size(); ++state)
+        bimapStates.addPair(states[state], classIds[classes[state]]);
+    for (std::size_t id = 0; id < representatives.size(); ++id)
+        bimapStates.addPair(states[representatives[id]], id);
+
+    std::unique_ptr<hx::TransitionFunctionTable> newTransitionTable =
+        std::make_unique<hx::TransitionFunctionTable>(representatives.size(),
+                                                      numberOfActions);
+    for (std::size_t id = 0; id < representatives.size(); ++id) {
+        for (std::size_t action = 0; action < numberOfActions; ++action) {
+            auto transform = transitions[representatives[id] * numberOfActions + action];
+            newTransitionTable->set(
+                id,
+                action,
+                transform == sink ? DFA::INVALID_STATE : classIds[classes[transform]]);
+        }
     }
 
     return new TransitionFunctionTableIndirect(
         std::move(newTransitionTable), bimapStates, bimapActions);
 }
+
+DFA DFA::product(const DFA &a, const DFA &b, DFAProductType type, std::size_t stateBudget) {
+    using StatePair = std::pair<std::size_t, std::size_t>;
+    const auto numberOfActions = std::max(a.getNumberOfActions(), b.getNumberOfActions());
+
+    auto step = [](const DFA &dfa, std::size_t state, std::size_t action) {
+        if (state >= dfa.getNumberOfStates() || action >= dfa.getNumberOfActions())
+            return DFA::INVALID_STATE;
+        return DFACheckedTransition(dfa._transitionFunction.get(), state, action);
+    };
+    auto isFinal = [](const DFA &dfa, std::size_t state) {
+        return state < dfa.getNumberOfStates() && dfa.isFinalState(state);
+    };
+
+    // pairs where a side the result depends on has already died are not explored,
+    // their transitions go to a single non-final dead state instead
+    auto isAlive = [&](const StatePair &pair) {
+        bool aliveA = pair.first < a.getNumberOfStates();
+        bool aliveB = pair.second < b.getNumberOfStates();
+        switch (type) {
+            case DFAProductType::INTERSECTION:
+                return aliveA && aliveB;
+            case DFAProductType::UNION:
+                return aliveA || aliveB;
+            case DFAProductType::DIFFERENCE:
+                return aliveA;
+        }
+        return false;
+    };
+
+    std::unordered_map<StatePair, std::size_t, TransitionFunctionMap::pair_hash> ids;
+    std::vector<StatePair> pairs = {{a.getStartingState(), b.getStartingState()}};
+    std::vector<std::size_t> transitions;
+    std::vector<std::size_t> finalStates;
+    ids.emplace(pairs.front(), 0);
+
+    for (std::size_t id = 0; id < pairs.size(); ++id) {
+        auto pair = pairs[id];
+        if (DFAProductAccepts(type, isFinal(a, pair.first), isFinal(b, pair.second)))
+            finalStates.push_back(id);
+
+        for (std::size_t action = 0; action < numberOfActions; ++action) {
+            StatePair transform(step(a, pair.first, action), step(b, pair.second, action));
+            if (!isAlive(transform)) {
+                transitions.push_back(DFA::INVALID_STATE);
+                continue;
+            }
+
+            auto inserted = ids.emplace(transform, pairs.size());
+            if (inserted.second) {
+                if (pairs.size() >= stateBudget)
+                    throw std::length_error("DFA product exceeds the state budget");
+                pairs.push_back(transform);
+            }
+            transitions.push_back(inserted.first->second);
+        }
+    }
+
+    // the table is dense, so the dead state is a real row looping on itself, like the
+    // sink of DFACompileToMinimalTable
+    const bool hasDead =
+        std::find(transitions.begin(), transitions.end(), DFA::INVALID_STATE)
+        != transitions.end();
+    const std::size_t dead = pairs.size();
+    const std::size_t numberOfStates = pairs.size() + (hasDead ? 1 : 0);
+
+    auto table =
+        std::make_unique<hx::TransitionFunctionTable>(numberOfStates, numberOfActions);
+    for (std::size_t id = 0; id < pairs.size(); ++id) {
+        for (std::size_t action = 0; action < numberOfActions; ++action) {
+            auto transform = transitions[id * numberOfActions + action];
+            table->set(id, action, transform == DFA::INVALID_STATE ? dead : transform);
+        }
+    }
+    if (hasDead) {
+        for (std::size_t action = 0; action < numberOfActions; ++action)
+            table->set(dead, action, dead);
+    }
+
+    return DFA(std::move(table), 0, finalStates, numberOfStates, numberOfActions);
+}
 }// namespace hx
\ No newline at end of file
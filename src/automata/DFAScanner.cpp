@@ -0,0 +1,168 @@
+#include "automata/DFAScanner.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace hx {
+
+namespace {
+constexpr std::uint32_t UNASSIGNED_STATE = std::numeric_limits<std::uint32_t>::max();
+
+const std::uint8_t *findFirstOf(const std::uint8_t *begin,
+                                const std::uint8_t *end,
+                                const std::uint8_t *symbols,
+                                std::size_t count) {
+    if (count == 0) return end;
+    if (count == 1) {
+        auto found = std::memchr(begin, symbols[0], end - begin);
+        return found ? static_cast<const std::uint8_t *>(found) : end;
+    }
+
+    // for two symbols the third needle repeats the second one, so the loop body
+    // stays branch free
+    const std::uint8_t s0 = symbols[0], s1 = symbols[1];
+    const std::uint8_t s2 = count > 2 ? symbols[2] : symbols[1];
+
+#if defined(__AVX2__)
+    const __m256i n0 = _mm256_set1_epi8(static_cast<char>(s0));
+    const __m256i n1 = _mm256_set1_epi8(static_cast<char>(s1));
+    const __m256i n2 = _mm256_set1_epi8(static_cast<char>(s2));
+    for (; end - begin >= 32; begin += 32) {
+        const __m256i block =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+        const __m256i hits = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, n0), _mm256_cmpeq_epi8(block, n1)),
+            _mm256_cmpeq_epi8(block, n2));
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask) return begin + __builtin_ctz(mask);
+    }
+#elif defined(__SSE2__)
+    const __m128i n0 = _mm_set1_epi8(static_cast<char>(s0));
+    const __m128i n1 = _mm_set1_epi8(static_cast<char>(s1));
+    const __m128i n2 = _mm_set1_epi8(static_cast<char>(s2));
+    for (; end - begin >= 16; begin += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        const __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, n0), _mm_cmpeq_epi8(block, n1)),
+            _mm_cmpeq_epi8(block, n2));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask) return begin + __builtin_ctz(mask);
+    }
+#endif
+
+    for (; begin != end; ++begin) {
+        if (*begin == s0 || *begin == s1 || *begin == s2) return begin;
+    }
+    return end;
+}
+}// namespace
+
+DFAScanner::DFAScanner(const hx::DFA &dfa)
+    : _internalStates(dfa.getNumberOfStates(), UNASSIGNED_STATE) {
+    const auto &transitionFunction = dfa.getTransitionFunction();
+    const auto numberOfStates = dfa.getNumberOfStates();
+    const auto numberOfActions = std::min(dfa.getNumberOfActions(), ALPHABET_SIZE);
+
+    std::queue<std::size_t> q;
+    q.push(dfa.getStartingState());
+    _internalStates[dfa.getStartingState()] = 0;
+    _externalStates.push_back(dfa.getStartingState());
+
+    // rows are appended in discovery order, so the row index is the internal id
+    while (!q.empty()) {
+        auto current = q.front();
+        q.pop();
+
+        _finalStates.push_back(dfa.isFinalState(current));
+        for (std::size_t action = 0; action < ALPHABET_SIZE; ++action) {
+            std::size_t transform = DFA::INVALID_STATE;
+            if (action < numberOfActions) {
+                try {
+                    transform = transitionFunction.get(current, action);
+                } catch (std::out_of_range &) {
+                }
+            }
+
+            if (transform >= numberOfStates) {
+                _table.push_back(UNASSIGNED_STATE);
+                continue;
+            }
+
+            if (_internalStates[transform] == UNASSIGNED_STATE) {
+                _internalStates[transform] = _externalStates.size();
+                _externalStates.push_back(transform);
+                q.push(transform);
+            }
+            _table.push_back(_internalStates[transform]);
+        }
+    }
+
+    // every missing transition goes to a non final sink that loops on itself
+    _startingState = 0;
+    _deadState = _externalStates.size();
+    _externalStates.push_back(DFA::INVALID_STATE);
+    _finalStates.push_back(0);
+    for (auto &transform : _table) {
+        if (transform == UNASSIGNED_STATE) transform = _deadState;
+    }
+    _table.resize(_table.size() + ALPHABET_SIZE, _deadState);
+
+    _createAcceleration();
+}
+
+void DFAScanner::_createAcceleration() {
+    _acceleration.resize(_externalStates.size());
+
+    for (std::uint32_t state = 0; state < _externalStates.size(); ++state) {
+        auto &acceleration = _acceleration[state];
+        acceleration.count = NOT_ACCELERATED;
+
+        // final states have to be reported on every symbol, so they cannot be skipped
+        if (_finalStates[state]) continue;
+
+        std::size_t escapes = 0;
+        const auto *row = _table.data() + state * ALPHABET_SIZE;
+        for (std::size_t action = 0; action < ALPHABET_SIZE; ++action) {
+            if (row[action] == state) continue;
+            if (++escapes > MAX_ESCAPE_SYMBOLS) break;
+            acceleration.symbols[escapes - 1] = static_cast<std::uint8_t>(action);
+        }
+
+        if (escapes <= MAX_ESCAPE_SYMBOLS)
+            acceleration.count = static_cast<std::uint8_t>(escapes);
+    }
+}
+
+bool DFAScanner::isAccelerated(std::size_t state) const {
+    if (state >= _internalStates.size() || _internalStates[state] == UNASSIGNED_STATE)
+        return false;
+    return _acceleration[_internalStates[state]].count != NOT_ACCELERATED;
+}
+
+std::size_t DFAScanner::scan(const std::uint8_t *begin,
+                             const std::uint8_t *end,
+                             std::vector<std::size_t> &offsets) const {
+    const std::uint32_t *table = _table.data();
+    const char *finalStates = _finalStates.data();
+    std::uint32_t state = _startingState;
+
+    for (const std::uint8_t *it = begin; it != end; ++it) {
+        const auto &acceleration = _acceleration[state];
+        if (acceleration.count != NOT_ACCELERATED) {
+            it = findFirstOf(it, end, acceleration.symbols.data(), acceleration.count);
+            if (it == end) break;
+        }
+
+        state = table[state * ALPHABET_SIZE + *it];
+        if (finalStates[state]) offsets.push_back(it - begin);
+    }
+
+    return _externalStates[state];
+}
+}// namespace hx
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "automata/NFA.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace hx {
+
+namespace {
+constexpr std::size_t NO_ACTION = std::numeric_limits<std::size_t>::max();
+}
+
+NFA::NFA(const ContainerMap &stateTransitionMap,
+         const std::vector<std::size_t> &startingStates,
+         const std::vector<std::size_t> &finalStates) {
+    std::size_t numberOfStates = 0, numberOfActions = 0;
+    for (const auto &it : stateTransitionMap) {
+        numberOfStates = std::max(numberOfStates, it.first.first + 1);
+        numberOfActions = std::max(numberOfActions, it.first.second + 1);
+        for (auto target : it.second)
+            numberOfStates = std::max(numberOfStates, target + 1);
+    }
+    for (auto state : startingStates)
+        numberOfStates = std::max(numberOfStates, state + 1);
+
+    std::vector<char> isFinal(numberOfStates, 0);
+    for (auto state : finalStates) {
+        if (state < numberOfStates) isFinal[state] = 1;
+    }
+
+    // position is a pair (state, entering action), starting states enter with none
+    std::unordered_map<std::pair<std::size_t, std::size_t>,
+                       std::size_t,
+                       TransitionFunctionMap::pair_hash>
+        positions;
+    std::vector<std::size_t> positionStates;
+    auto getPosition = [&](std::size_t state, std::size_t action) -> std::size_t {
+        auto inserted = positions.emplace(std::make_pair(state, action), positions.size());
+        if (inserted.second) {
+            if (positions.size() > MAX_POSITIONS)
+                throw std::length_error("NFA does not fit into 64 bit-parallel positions");
+            positionStates.push_back(state);
+        }
+        return inserted.first->second;
+    };
+
+    _symbolMasks.resize(numberOfActions, 0);
+    for (auto state : startingStates)
+        _startingStates |= StateSet(1) << getPosition(state, NO_ACTION);
+
+    std::vector<StateSet> outgoing(numberOfStates, 0);
+    for (const auto &it : stateTransitionMap) {
+        for (auto target : it.second) {
+            auto position = getPosition(target, it.first.second);
+            outgoing[it.first.first] |= StateSet(1) << position;
+            _symbolMasks[it.first.second] |= StateSet(1) << position;
+        }
+    }
+
+    _numberOfPositions = positionStates.size();
+    for (std::size_t position = 0; position < _numberOfPositions; ++position) {
+        if (isFinal[positionStates[position]]) _finalStates |= StateSet(1) << position;
+    }
+
+    auto chunks = (_numberOfPositions + CHUNK_BITS - 1) / CHUNK_BITS;
+    _followTable.resize(std::max<std::size_t>(chunks, 1) * CHUNK_SIZE, 0);
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        for (std::size_t value = 1; value < CHUNK_SIZE; ++value) {
+            StateSet follow = 0;
+            for (std::size_t bit = 0; bit < CHUNK_BITS; ++bit) {
+                auto position = chunk * CHUNK_BITS + bit;
+                if ((value >> bit & 1) && position < _numberOfPositions)
+                    follow |= outgoing[positionStates[position]];
+            }
+            _followTable[chunk * CHUNK_SIZE + value] = follow;
+        }
+    }
+
+    reset();
+}
+
+NFA NFA::fromSequence(const std::vector<std::vector<std::size_t>> &symbolClasses,
+                      bool unanchored) {
+    if (symbolClasses.size() >= MAX_POSITIONS)
+        throw std::length_error("Sequence does not fit into 64 bit-parallel positions");
+
+    NFA result;
+    std::size_t numberOfActions = 0;
+    for (const auto &symbols : symbolClasses) {
+        for (auto symbol : symbols)
+            numberOfActions = std::max(numberOfActions, symbol + 1);
+    }
+
+    // position 0 is the empty prefix, position i matches the first i classes
+    result._symbolMasks.resize(numberOfActions, 0);
+    for (std::size_t i = 0; i < symbolClasses.size(); ++i) {
+        for (auto symbol : symbolClasses[i])
+            result._symbolMasks[symbol] |= StateSet(1) << (i + 1);
+    }
+
+    result._numberOfPositions = symbolClasses.size() + 1;
+    result._startingStates = 1;
+    result._persistentStates = unanchored ? 1 : 0;
+    result._finalStates = StateSet(1) << symbolClasses.size();
+    result.reset();
+
+    return result;
+}
+}// namespace hx
\ No newline at end of file
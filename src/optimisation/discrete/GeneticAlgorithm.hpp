@@ -4,9 +4,10 @@
 
 #include "ThreadPool.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <random>
-#include <set>
+#include <vector>
 
 namespace hx {
 namespace optimisation {
@@ -37,6 +38,7 @@ public:
             this->_populationSorted[i] = i;
         }
 
+        this->_indexesToRemove.reserve(this->_crossoverFactor);
         this->_population.reserve(this->_populationSize);
         for (std::size_t i = 0; i < this->_populationSize; ++i) {
             this->_population.push_back(std::move(this->_solutionFactory()));
@@ -81,24 +83,31 @@ protected:
                   });
 
         if (_populationScore[_populationSorted[0]] < _bestSolution.getScore()) {
+            // the score is carried over, so the copy is never rescored
             this->_bestSolution = _population[_populationSorted[0]];
-            this->_bestSolution.invalidateScore();
         }
     }
 
     void crossoverPopulation() {
-        std::set<std::size_t> indexesToRemove;
+        // reused between epochs, so selecting children does not allocate
+        auto &indexesToRemove = this->_indexesToRemove;
+        indexesToRemove.clear();
+
         std::geometric_distribution selection(0.1);
         for (std::size_t i = 0; i < this->_crossoverFactor; ++i) {
             std::size_t randomSolutionIndex = selection(this->_randomness);
             if (randomSolutionIndex < this->_populationSize)
-                indexesToRemove.insert(
+                indexesToRemove.push_back(
                     this->_populationSorted[this->_populationSize - randomSolutionIndex
                                             - 1]);
         }
 
-        while (!indexesToRemove.empty()) {
-            std::size_t childIndex = *indexesToRemove.begin();
+        std::sort(indexesToRemove.begin(), indexesToRemove.end());
+        indexesToRemove.erase(std::unique(indexesToRemove.begin(), indexesToRemove.end()),
+                              indexesToRemove.end());
+
+        for (auto childIndex = indexesToRemove.begin();
+             childIndex != indexesToRemove.end();) {
             std::size_t parrentA, parrentB;
 
             parrentA = selection(this->_randomness);
@@ -109,14 +118,14 @@ protected:
             parrentA = this->_populationSorted[parrentA];
             parrentB = this->_populationSorted[parrentB];
 
-            if (parrentA == parrentB || parrentA == childIndex || parrentB == childIndex)
+            if (parrentA == parrentB || parrentA == *childIndex || parrentB == *childIndex)
                 continue;
 
             this->crossoverSolution(this->_population[parrentA],
                                     this->_population[parrentB],
-                                    this->_population[childIndex]);
-            this->_population[childIndex].invalidateScore();
-            indexesToRemove.erase(childIndex);
+                                    this->_population[*childIndex]);
+            this->_population[*childIndex].invalidateScore();
+            ++childIndex;
         }
     }
 
@@ -140,6 +149,7 @@ private:
     std::vector<T> _population;
     std::vector<std::size_t> _populationSorted;
     std::vector<ScoreType> _populationScore;
+    std::vector<std::size_t> _indexesToRemove;
     T _bestSolution;
 
     std::default_random_engine _randomness;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <optional>
+#include <stdexcept>
 
 namespace hx {
 namespace optimisation {
@@ -20,12 +21,35 @@ public:
         this->invalidateScore();
     }
 
+    // In place proposals: propose() applies a neighbouring move, then reject() reverts
+    // it, score included, or accept() keeps it. Only solutions able to undo their last
+    // move support them, others are copied before changeSolution() instead; reject()
+    // throws for them rather than keep the old score over the moved data.
+    virtual bool supportsUndo() const noexcept { return false; }
+
+    void propose() {
+        previousScore = score;
+        this->changeSolution();
+    }
+    void reject() {
+        if (!this->supportsUndo())
+            throw std::logic_error("Solution cannot undo its last move");
+        this->undoNeighbouring_();
+        score = previousScore;
+    }
+    void accept() noexcept { this->commitNeighbouring_(); }
+
 protected:
     virtual T scoreSolution() const = 0;
     virtual void neighbouring_() = 0;
+    // reverts the last neighbouring_(), called at most once after it
+    virtual void undoNeighbouring_() {}
+    // the last neighbouring_() stays, its undo information can be dropped
+    virtual void commitNeighbouring_() {}
 
 private:
     std::optional<T> score;
+    std::optional<T> previousScore;
 };
 
 }// namespace discrete
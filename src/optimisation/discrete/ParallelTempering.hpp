@@ -0,0 +1,169 @@
+#pragma once
+
+#include "optimisation/discrete/OptimisationSolution.hpp"
+#include "optimisation/discrete/SimulatedAnnealing.hpp"
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hx {
+namespace optimisation {
+namespace discrete {
+
+namespace __internal {
+// Solutions drawing from a shared engine (RuleSolution) expose setRandomEngine(), so
+// every replica can give its chain a private one
+template <typename T, typename = void>
+struct HasRandomEngine : std::false_type {};
+
+template <typename T>
+struct HasRandomEngine<T,
+                       std::void_t<decltype(std::declval<T &>().setRandomEngine(
+                           std::declval<std::default_random_engine &>()))>>
+    : std::true_type {};
+}// namespace __internal
+
+// Replica exchange: `replicas` annealing chains at fixed temperatures spaced
+// geometrically between minTemp and maxTemp run in parallel, and after every epoch
+// neighbouring chains try to exchange their solutions, so good solutions found hot
+// sink to the cold end. Even and odd neighbour pairs are tried on alternate epochs.
+template <typename T,
+          typename ScoreType = std::size_t,
+          typename = std::enable_if_t<std::is_base_of_v<
+              hx::optimisation::discrete::OptimisationSolution<ScoreType>,
+              T>>>
+class ParallelTempering {
+public:
+    ParallelTempering(const T &startingSolution,
+                      std::size_t replicas,
+                      double minTemp,
+                      double maxTemp,
+                      std::size_t stepsOnEpoch = 1)
+        : _bestSolution(startingSolution)
+        , _stepsOnEpoch(stepsOnEpoch)
+        , _randomness(std::random_device()())
+        , _threadPool(std::min<std::size_t>(
+              replicas, std::max(1u, std::thread::hardware_concurrency()))) {
+        if (replicas == 0 || minTemp <= 0.0 || maxTemp < minTemp)
+            throw std::invalid_argument(
+                "Parallel tempering needs replicas and 0 < minTemp <= maxTemp");
+
+        this->_replicas.reserve(replicas);
+        for (std::size_t i = 0; i < replicas; ++i) {
+            const double position = replicas == 1 ? 0.0 : double(i) / (replicas - 1);
+            this->_replicas.push_back(std::make_unique<Replica>(
+                startingSolution,
+                minTemp * std::pow(maxTemp / minTemp, position),
+                this->_randomness()));
+            this->bindRandomness(*this->_replicas.back());
+        }
+    }
+
+    std::size_t fitEpoch() {
+        std::vector<std::future<ScoreType>> done;
+        done.reserve(this->_replicas.size());
+        for (auto &replica : this->_replicas)
+            done.push_back(this->_threadPool.async_task(
+                [steps = this->_stepsOnEpoch](Replica *replica) -> ScoreType {
+                    for (std::size_t i = 0; i < steps; ++i)
+                        __internal::annealingStep(replica->current,
+                                                  replica->best,
+                                                  replica->temperature,
+                                                  replica->randomness);
+                    return replica->best.getScore();
+                },
+                replica.get()));
+        for (auto &it : done)
+            it.get();
+
+        this->exchangeReplicas();
+
+        for (auto &replica : this->_replicas)
+            if (replica->best.getScore() < this->_bestSolution.getScore())
+                this->_bestSolution = replica->best;
+        return this->_bestSolution.getScore();
+    }
+
+    T &getBest() { return this->_bestSolution; }
+
+    std::size_t replicas() const { return this->_replicas.size(); }
+    double temperature(std::size_t replica) const {
+        return this->_replicas[replica]->temperature;
+    }
+
+    // share of accepted exchanges between `replica` and the next hotter one, a
+    // ladder is usually spaced well when it stays around 0.2 - 0.4
+    double exchangeRate(std::size_t replica) const {
+        const auto &stats = *this->_replicas[replica];
+        if (stats.exchangesTried == 0) return 0.0;
+        return double(stats.exchangesAccepted) / stats.exchangesTried;
+    }
+
+private:
+    struct Replica {
+        Replica(const T &solution, double temperature, std::size_t seed)
+            : current(solution)
+            , best(solution)
+            , temperature(temperature)
+            , randomness(seed) {}
+
+        T current;
+        T best;
+        double temperature;
+        std::default_random_engine randomness;
+
+        std::size_t exchangesTried = 0;
+        std::size_t exchangesAccepted = 0;
+    };
+
+    void bindRandomness(Replica &replica) {
+        if constexpr (__internal::HasRandomEngine<T>::value) {
+            replica.current.setRandomEngine(replica.randomness);
+            replica.best.setRandomEngine(replica.randomness);
+        }
+    }
+
+    // swaps with probability min(1, exp((1/Tcold - 1/Thot) * (Ecold - Ehot)))
+    void exchangeReplicas() {
+        std::uniform_real_distribution<> probability(0.0, 1.0);
+        for (std::size_t i = this->_epoch++ % 2; i + 1 < this->_replicas.size(); i += 2) {
+            auto &cold = *this->_replicas[i];
+            auto &hot = *this->_replicas[i + 1];
+
+            const double exponent =
+                (1.0 / cold.temperature - 1.0 / hot.temperature)
+                * (static_cast<double>(cold.current.getScore())
+                   - static_cast<double>(hot.current.getScore()));
+
+            ++cold.exchangesTried;
+            if (exponent >= 0.0 || std::exp(exponent) > probability(this->_randomness)) {
+                ++cold.exchangesAccepted;
+                std::swap(cold.current, hot.current);
+                this->bindRandomness(cold);
+                this->bindRandomness(hot);
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Replica>> _replicas;
+    T _bestSolution;
+
+    std::size_t _stepsOnEpoch;
+    std::size_t _epoch = 0;
+    std::default_random_engine _randomness;
+    hx::ThreadPool<> _threadPool;
+};
+
+}// namespace discrete
+}// namespace optimisation
+}// namespace hx
\ No newline at end of file
@@ -10,6 +10,54 @@ namespace hx {
 namespace optimisation {
 namespace discrete {
 
+namespace __internal {
+// scores are compared as doubles, unsigned differences would wrap around
+inline bool acceptUphill(double scoreCur,
+                         double scoreNew,
+                         double temperature,
+                         double probability) {
+    return std::exp((scoreCur - scoreNew) / temperature) > probability;
+}
+
+// One Metropolis step: a neighbour of `current` replaces it if it scores better, or
+// with probability exp(-increase / temperature) otherwise. Solutions supporting
+// undo are changed in place and reverted on rejection, others are copied.
+template <typename T, typename Engine>
+void annealingStep(T &current, T &best, double temperature, Engine &randomness) {
+    std::uniform_real_distribution<> probability(0.0, 1.0);
+
+    if (current.supportsUndo()) {
+        auto scoreCur = current.getScore();
+        current.propose();
+        auto scoreNew = current.getScore();
+
+        if (scoreNew < scoreCur) {
+            current.accept();
+            if (scoreNew < best.getScore()) best = current;
+        } else if (acceptUphill(
+                       scoreCur, scoreNew, temperature, probability(randomness))) {
+            current.accept();
+        } else {
+            current.reject();
+        }
+        return;
+    }
+
+    T newSolution = current;
+
+    newSolution.changeSolution();
+    auto scoreNew = newSolution.getScore();
+    auto scoreCur = current.getScore();
+
+    if (scoreNew < scoreCur) {
+        current = newSolution;
+        if (scoreNew < best.getScore()) best = newSolution;
+    } else if (acceptUphill(scoreCur, scoreNew, temperature, probability(randomness))) {
+        current = newSolution;
+    }
+}
+}// namespace __internal
+
 template <typename T,
           typename ScoreType = std::size_t,
           typename = std::enable_if_t<std::is_base_of_v<
@@ -30,24 +78,11 @@ public:
         , _randomness(std::random_device()()) {}
 
     std::size_t fitEpoch() noexcept {
-        std::uniform_real_distribution<> probability(0.0, 1.0);
-        for (std::size_t i = 0; i < this->_stepsOnEpoch; ++i) {
-            T newSolution = this->_currentSolution;
-
-            newSolution.changeSolution();
-            auto scoreNew = newSolution.getScore();
-            auto scoreCur = this->_currentSolution.getScore();
-
-            if (scoreNew < scoreCur) {
-                this->_currentSolution = newSolution;
-                if (scoreNew < _bestSolution.getScore()) {
-                    _bestSolution = newSolution;
-                }
-            } else if (std::exp((scoreCur - scoreNew) / this->_currentTemp)
-                       > probability(this->_randomness)) {
-                this->_currentSolution = newSolution;
-            }
-        }
+        for (std::size_t i = 0; i < this->_stepsOnEpoch; ++i)
+            __internal::annealingStep(this->_currentSolution,
+                                      this->_bestSolution,
+                                      this->_currentTemp,
+                                      this->_randomness);
         this->_currentTemp *= this->_coolingFactor;
         return this->_bestSolution.getScore();
     }
@@ -20,6 +20,18 @@ BOOST_PYTHON_MODULE(libhxtk) {
                                                                        np::ndarray,
                                                                        double,
                                                                        double>())
+        .def(py::init<std::size_t,
+                      std::string,
+                      np::ndarray,
+                      np::ndarray,
+                      np::ndarray,
+                      double,
+                      double>())
         .def("fitEpoch", &hx::python::RuleExtractor::fitEpoch)
-        .def("getResult", &hx::python::RuleExtractor::getBest);
+        .def("getResult", &hx::python::RuleExtractor::getBest)
+        .def("allocationReport", &hx::python::RuleExtractor::allocationReport)
+        .def("shareControlPoints", &hx::python::RuleExtractor::shareControlPoints)
+        .staticmethod("shareControlPoints")
+        .def("unlinkControlPoints", &hx::python::RuleExtractor::unlinkControlPoints)
+        .staticmethod("unlinkControlPoints");
 }
\ No newline at end of file
@@ -4,8 +4,11 @@
 
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 
+#include "memory/SharedMemoryStorage.hpp"
 #include "ruleextraction/RuleExtractor.hpp"
 
 namespace hx {
@@ -22,80 +25,74 @@ public:
                   np::ndarray ruleClasses,
                   double crossoverFactor = 0.33,
                   double mutationFactor = 0.1) {
-        std::vector<std::size_t> ruleClassesValues;
-        std::vector<std::size_t> controlClassesValues;
+        checkPoints(controlPoints);
+        checkPoints(rulePoints);
 
-        auto expectedTypeClass = np::dtype::get_builtin<std::size_t>();
-        auto expectedTypePoints = np::dtype::get_builtin<float>();
-        if (!np::equivalent(controlClasses.get_dtype(), expectedTypeClass)
-            || !np::equivalent(ruleClasses.get_dtype(), expectedTypeClass))
-            throw std::invalid_argument(
-                "Cannot use class array of this type, cast to uint64 before creating "
-                "object");
-
-        if (!np::equivalent(rulePoints.get_dtype(), expectedTypePoints)
-            || !np::equivalent(controlPoints.get_dtype(), expectedTypePoints))
-            throw std::invalid_argument("Cannot use extractor on non-float datatype");
-
-        auto sizeofRuleClasses = 1;
-        auto sizeofControlClasses = 1;
-        std::size_t dims = rulePoints.shape(-1);
-
-        for (auto i = 0; i < ruleClasses.get_nd(); ++i) {
-            sizeofRuleClasses *= ruleClasses.shape(i);
-        }
-
-        for (auto i = 0; i < controlClasses.get_nd(); ++i) {
-            sizeofControlClasses *= controlClasses.shape(i);
-        }
+        _pImpl = std::make_unique<hx::ruleextraction::RuleExtractor>(
+            populationSize,
+            rulePoints.shape(-1),
+            classValues(controlClasses),
+            classValues(ruleClasses),
+            crossoverFactor,
+            mutationFactor);
 
-        for (auto ptr = reinterpret_cast<std::size_t*>(ruleClasses.get_data());
-             sizeofRuleClasses > 0;
-             --sizeofRuleClasses, ++ptr) {
-            ruleClassesValues.push_back(*ptr);
-        }
+        copyPoints(rulePoints, _pImpl->getRulesCentres(), _pImpl->getRulesNumber());
+        copyPoints(
+            controlPoints, _pImpl->getControlCentres(), _pImpl->getControlPointsNumber());
+    }
 
-        for (auto ptr = reinterpret_cast<std::size_t*>(controlClasses.get_data());
-             sizeofControlClasses > 0;
-             --sizeofControlClasses, ++ptr) {
-            controlClassesValues.push_back(*ptr);
-        }
+    // Control points attached read only from a segment made by shareControlPoints, so
+    // extractors in several processes use one copy
+    RuleExtractor(std::size_t populationSize,
+                  const std::string &controlPointsName,
+                  np::ndarray rulePoints,
+                  np::ndarray controlClasses,
+                  np::ndarray ruleClasses,
+                  double crossoverFactor = 0.33,
+                  double mutationFactor = 0.1) {
+        checkPoints(rulePoints);
 
         _pImpl = std::make_unique<hx::ruleextraction::RuleExtractor>(
             populationSize,
-            dims,
-            std::move(controlClassesValues),
-            std::move(ruleClassesValues),
+            rulePoints.shape(-1),
+            classValues(controlClasses),
+            classValues(ruleClasses),
+            hx::memory::mapSharedMemory(controlPointsName,
+                                        hx::memory::SharedMemoryMode::READ_ONLY),
             crossoverFactor,
             mutationFactor);
 
-        auto controlData = _pImpl->getControlCentres();
-        auto rulesData = _pImpl->getRulesCentres();
-        auto dim = _pImpl->getDims();
+        copyPoints(rulePoints, _pImpl->getRulesCentres(), _pImpl->getRulesNumber());
+    }
 
-        auto numpyDataRules = reinterpret_cast<float*>(rulePoints.get_data());
-        if (_pImpl->getRulesNumber() != (std::size_t) rulePoints.shape(0)
-            || dim != (std::size_t) rulePoints.shape(1))
-            std::cerr << "Size rules mismatches\n";
+    // Copies control points into a new shared memory segment, laid out the way
+    // RuleExtractor reads them
+    static void shareControlPoints(const std::string &name, np::ndarray controlPoints) {
+        checkPoints(controlPoints);
 
-        for (std::size_t i = 0; i < _pImpl->getRulesNumber(); ++i) {
-            std::copy(numpyDataRules, numpyDataRules + _pImpl->getDims(), rulesData);
-            rulesData += _pImpl->getStride();
-            numpyDataRules += rulePoints.strides(0) / sizeof(float);
-        }
+        std::size_t dims = controlPoints.shape(-1);
+        std::size_t stride = hx::memory::value_padding<8>(dims);
+        std::size_t points = controlPoints.shape(0);
 
-        auto numpyDataControl = reinterpret_cast<float*>(controlPoints.get_data());
+        auto storage = hx::memory::mapSharedMemory(name,
+                                                   hx::memory::SharedMemoryMode::CREATE,
+                                                   stride * points * sizeof(float));
+        copyPoints(controlPoints, storage.get_as<float>(), points, stride);
+    }
 
-        for (std::size_t i = 0; i < _pImpl->getControlPointsNumber(); ++i) {
-            std::copy(
-                numpyDataControl, numpyDataControl + _pImpl->getDims(), controlData);
-            controlData += _pImpl->getStride();
-            numpyDataControl += controlPoints.strides(0) / sizeof(float);
-        }
+    static void unlinkControlPoints(const std::string &name) {
+        hx::memory::unlinkSharedMemory(name);
     }
 
     std::size_t fitEpoch() { return _pImpl->fitEpoch(); }
 
+    // live and peak bytes of the extractor, per tag
+    std::string allocationReport() const {
+        std::ostringstream report;
+        _pImpl->getAllocationTracker().report(report);
+        return report.str();
+    }
+
     np::ndarray getBest() const {
         np::ndarray result =
             np::zeros(py::make_tuple(_pImpl->getRulesNumber(), _pImpl->getDims() * 2 + 1),
@@ -125,6 +122,53 @@ public:
     }
 
 private:
+    static std::vector<std::size_t> classValues(np::ndarray classes) {
+        if (!np::equivalent(classes.get_dtype(), np::dtype::get_builtin<std::size_t>()))
+            throw std::invalid_argument(
+                "Cannot use class array of this type, cast to uint64 before creating "
+                "object");
+
+        auto sizeofClasses = 1;
+        for (auto i = 0; i < classes.get_nd(); ++i) {
+            sizeofClasses *= classes.shape(i);
+        }
+
+        std::vector<std::size_t> values;
+        for (auto ptr = reinterpret_cast<std::size_t*>(classes.get_data());
+             sizeofClasses > 0;
+             --sizeofClasses, ++ptr) {
+            values.push_back(*ptr);
+        }
+        return values;
+    }
+
+    static void checkPoints(np::ndarray points) {
+        if (!np::equivalent(points.get_dtype(), np::dtype::get_builtin<float>()))
+            throw std::invalid_argument("Cannot use extractor on non-float datatype");
+    }
+
+    void copyPoints(np::ndarray points, float* data, std::size_t expectedPoints) {
+        if (expectedPoints != (std::size_t) points.shape(0)
+            || _pImpl->getDims() != (std::size_t) points.shape(1))
+            std::cerr << "Size points mismatches\n";
+
+        copyPoints(points, data, expectedPoints, _pImpl->getStride());
+    }
+
+    static void copyPoints(np::ndarray points,
+                           float* data,
+                           std::size_t numberOfPoints,
+                           std::size_t stride) {
+        auto numpyData = reinterpret_cast<float*>(points.get_data());
+        std::size_t dims = points.shape(-1);
+
+        for (std::size_t i = 0; i < numberOfPoints; ++i) {
+            std::copy(numpyData, numpyData + dims, data);
+            data += stride;
+            numpyData += points.strides(0) / sizeof(float);
+        }
+    }
+
     std::unique_ptr<hx::ruleextraction::RuleExtractor> _pImpl;
 };
 }// namespace python
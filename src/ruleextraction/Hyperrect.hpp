@@ -0,0 +1,158 @@
+#pragma once
+
+#include "memory/Kernels.hpp"
+
+#include <cstddef>
+#include <utility>
+
+namespace hx {
+namespace ruleextraction {
+
+// Whether `point` lies in the box centre - lower <= point <= centre + upper, bounds
+// included, over the first `dims` floats of each row. The padding behind them is
+// never read, so rows need no particular alignment or stride.
+
+// reference the vector kernels are verified against
+inline bool insideHyperrectScalar(const float *point,
+                                  const float *centre,
+                                  const float *lower,
+                                  const float *upper,
+                                  std::size_t dims) {
+    for (std::size_t i = 0; i < dims; ++i, ++point, ++centre, ++lower, ++upper) {
+        if (*point < *centre - *lower || *point > *centre + *upper) return false;
+    }
+
+    return true;
+}
+
+#ifdef __HX_KERNELS_X86
+namespace __internal {
+// lanes of x outside [c - l, c + u], the ordered comparisons keep NaN inside
+__attribute__((target("avx2"))) inline __m256 outsideAVX2(__m256 x,
+                                                          __m256 c,
+                                                          __m256 l,
+                                                          __m256 u) {
+    return _mm256_or_ps(_mm256_cmp_ps(x, _mm256_sub_ps(c, l), _CMP_LT_OQ),
+                        _mm256_cmp_ps(x, _mm256_add_ps(c, u), _CMP_GT_OQ));
+}
+}// namespace __internal
+
+// Eight dimensions at a time, the last partial block through masked loads
+__attribute__((target("avx2"))) inline bool insideHyperrectAVX2(const float *point,
+                                                                const float *centre,
+                                                                const float *lower,
+                                                                const float *upper,
+                                                                std::size_t dims) {
+    std::size_t i = 0;
+    for (; i + 8 <= dims; i += 8) {
+        const __m256 out = __internal::outsideAVX2(_mm256_loadu_ps(point + i),
+                                                   _mm256_loadu_ps(centre + i),
+                                                   _mm256_loadu_ps(lower + i),
+                                                   _mm256_loadu_ps(upper + i));
+        if (!_mm256_testz_ps(out, out)) return false;
+    }
+
+    if (i < dims) {
+        const __m256i lanes = _mm256_cmpgt_epi32(
+            _mm256_set1_epi32(static_cast<int>(dims - i)),
+            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m256 out =
+            _mm256_and_ps(__internal::outsideAVX2(_mm256_maskload_ps(point + i, lanes),
+                                                  _mm256_maskload_ps(centre + i, lanes),
+                                                  _mm256_maskload_ps(lower + i, lanes),
+                                                  _mm256_maskload_ps(upper + i, lanes)),
+                          _mm256_castsi256_ps(lanes));
+        if (!_mm256_testz_ps(out, out)) return false;
+    }
+
+    return true;
+}
+
+__attribute__((target("avx512f"))) inline bool insideHyperrectAVX512(
+    const float *point,
+    const float *centre,
+    const float *lower,
+    const float *upper,
+    std::size_t dims) {
+    for (std::size_t i = 0; i < dims; i += 16) {
+        const __mmask16 lanes =
+            dims - i >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (dims - i)) - 1);
+        const __m512 x = _mm512_maskz_loadu_ps(lanes, point + i);
+        const __m512 c = _mm512_maskz_loadu_ps(lanes, centre + i);
+        const __m512 l = _mm512_maskz_loadu_ps(lanes, lower + i);
+        const __m512 u = _mm512_maskz_loadu_ps(lanes, upper + i);
+
+        if (_mm512_mask_cmp_ps_mask(lanes, x, _mm512_sub_ps(c, l), _CMP_LT_OQ)
+            | _mm512_mask_cmp_ps_mask(lanes, x, _mm512_add_ps(c, u), _CMP_GT_OQ))
+            return false;
+    }
+
+    return true;
+}
+#endif
+
+// Calls `scan(inside)` with a functor `inside(point, centre, lower, upper, dims)`
+// testing with the kernel of `isa`, which the CPU has to support. A scan picks the
+// kernel once and every point is then a direct call, not one through a pointer.
+template <typename Scan>
+void withHyperrectKernel(hx::memory::KernelIsa isa, Scan &&scan) {
+#ifdef __HX_KERNELS_X86
+    if (isa == hx::memory::KernelIsa::AVX512) {
+        return scan([](const float *point,
+                       const float *centre,
+                       const float *lower,
+                       const float *upper,
+                       std::size_t dims) {
+            return insideHyperrectAVX512(point, centre, lower, upper, dims);
+        });
+    }
+    if (isa == hx::memory::KernelIsa::AVX2) {
+        return scan([](const float *point,
+                       const float *centre,
+                       const float *lower,
+                       const float *upper,
+                       std::size_t dims) {
+            return insideHyperrectAVX2(point, centre, lower, upper, dims);
+        });
+    }
+#endif
+    return scan([](const float *point,
+                   const float *centre,
+                   const float *lower,
+                   const float *upper,
+                   std::size_t dims) {
+        return insideHyperrectScalar(point, centre, lower, upper, dims);
+    });
+}
+
+// with the widest kernel of this CPU
+template <typename Scan>
+void withHyperrectKernel(Scan &&scan) {
+    withHyperrectKernel(hx::memory::kernelIsa(), std::forward<Scan>(scan));
+}
+
+// with the kernel of `isa`, which the CPU has to support
+inline bool insideHyperrect(const float *point,
+                            const float *centre,
+                            const float *lower,
+                            const float *upper,
+                            std::size_t dims,
+                            hx::memory::KernelIsa isa) {
+    bool inside = false;
+    withHyperrectKernel(isa, [&](auto kernel) {
+        inside = kernel(point, centre, lower, upper, dims);
+    });
+    return inside;
+}
+
+// with the widest kernel of this CPU
+inline bool insideHyperrect(const float *point,
+                            const float *centre,
+                            const float *lower,
+                            const float *upper,
+                            std::size_t dims) {
+    return insideHyperrect(point, centre, lower, upper, dims, hx::memory::kernelIsa());
+}
+
+}// namespace ruleextraction
+}// namespace hx
\ No newline at end of file
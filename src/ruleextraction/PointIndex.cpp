@@ -0,0 +1,80 @@
+#include "ruleextraction/PointIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace hx {
+namespace ruleextraction {
+
+void PointIndex::build(const float *points,
+                       std::size_t count,
+                       std::size_t dims,
+                       std::size_t stride) {
+    if (count > std::numeric_limits<std::uint32_t>::max())
+        throw std::invalid_argument("Too many points to index");
+
+    this->_dims = dims;
+    this->_nodes.clear();
+    this->_order.clear();
+    this->_unindexed.clear();
+    if (dims == 0 || dims > MAX_DIMS || (count >> dims) < LEAF_SIZE) return;
+
+    // NaN breaks the ordering the splits rely on
+    this->_order.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const float *point = points + i * stride;
+        const bool finite = std::all_of(
+            point, point + dims, [](float value) { return std::isfinite(value); });
+        (finite ? this->_order : this->_unindexed).push_back(i);
+    }
+
+    this->_nodes.reserve(2 * count / LEAF_SIZE + 1);
+    this->buildNode(points, stride, 0, static_cast<std::uint32_t>(this->_order.size()));
+}
+
+// splits at the median of the dimension the points spread the most along
+std::uint32_t PointIndex::buildNode(const float *points,
+                                    std::size_t stride,
+                                    std::uint32_t begin,
+                                    std::uint32_t end) {
+    const auto index = static_cast<std::uint32_t>(this->_nodes.size());
+    this->_nodes.push_back(Node{begin, end});
+    if (end - begin <= LEAF_SIZE) return index;
+
+    std::uint32_t dim = 0;
+    float widest = -1.0f;
+    for (std::size_t d = 0; d < this->_dims; ++d) {
+        auto [low, high] = std::minmax_element(
+            this->_order.begin() + begin,
+            this->_order.begin() + end,
+            [&](std::uint32_t a, std::uint32_t b) {
+                return points[a * stride + d] < points[b * stride + d];
+            });
+        const float spread = points[*high * stride + d] - points[*low * stride + d];
+        if (spread > widest) widest = spread, dim = static_cast<std::uint32_t>(d);
+    }
+
+    const std::uint32_t middle = begin + (end - begin) / 2;
+    std::nth_element(this->_order.begin() + begin,
+                     this->_order.begin() + middle,
+                     this->_order.begin() + end,
+                     [&](std::uint32_t a, std::uint32_t b) {
+                         return points[a * stride + dim] < points[b * stride + dim];
+                     });
+
+    const float split = points[this->_order[middle] * stride + dim];
+    const auto left = this->buildNode(points, stride, begin, middle);
+    const auto right = this->buildNode(points, stride, middle, end);
+
+    Node &node = this->_nodes[index];
+    node.left = left;
+    node.right = right;
+    node.dim = dim;
+    node.split = split;
+    return index;
+}
+
+}// namespace ruleextraction
+}// namespace hx
\ No newline at end of file
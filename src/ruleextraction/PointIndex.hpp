@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hx {
+namespace ruleextraction {
+
+// k-d tree over points stored in rows of `stride` floats, answering which points may
+// lie in an axis aligned box. The tree only pays off while the points clearly
+// outnumber the 2^dims cells it splits the space into; beyond that (or before
+// build()) it is disabled and callers scan every point instead.
+class PointIndex {
+public:
+    constexpr static std::size_t LEAF_SIZE = 16;
+    constexpr static std::size_t MAX_DIMS = 16;
+
+    PointIndex() = default;
+    PointIndex(const float *points,
+               std::size_t count,
+               std::size_t dims,
+               std::size_t stride) {
+        this->build(points, count, dims, stride);
+    }
+
+    // (re)builds the tree, the points are not referenced afterwards
+    void build(const float *points,
+               std::size_t count,
+               std::size_t dims,
+               std::size_t stride);
+
+    bool enabled() const { return !this->_nodes.empty(); }
+
+    // Calls `visit(point)` for every point of the leaves overlapping the box
+    // low <= x <= high, a superset of the points inside. Only for enabled indices.
+    // NaN compares as inside in insideHyperrect, so points with a non finite
+    // coordinate are always visited, and a NaN bound visits every point.
+    template <typename Visitor>
+    void forEachCandidate(const float *low, const float *high, Visitor &&visit) const {
+        for (auto point : this->_unindexed)
+            visit(std::size_t(point));
+
+        for (std::size_t d = 0; d < this->_dims; ++d) {
+            if (std::isnan(low[d]) || std::isnan(high[d])) {
+                for (auto point : this->_order)
+                    visit(std::size_t(point));
+                return;
+            }
+        }
+        this->visitNode(0, low, high, visit);
+    }
+
+private:
+    struct Node {
+        // leaves have no children and hold the points _order[begin, end)
+        std::uint32_t begin, end;
+        std::uint32_t left = 0, right = 0;
+        std::uint32_t dim = 0;
+        float split = 0.0f;
+    };
+
+    std::uint32_t buildNode(const float *points,
+                            std::size_t stride,
+                            std::uint32_t begin,
+                            std::uint32_t end);
+
+    template <typename Visitor>
+    void visitNode(std::uint32_t index,
+                   const float *low,
+                   const float *high,
+                   Visitor &visit) const {
+        const Node &node = this->_nodes[index];
+        if (node.left == 0) {
+            for (auto i = node.begin; i < node.end; ++i)
+                visit(std::size_t(this->_order[i]));
+            return;
+        }
+
+        // points equal to the split may be on either side
+        if (low[node.dim] <= node.split) this->visitNode(node.left, low, high, visit);
+        if (high[node.dim] >= node.split) this->visitNode(node.right, low, high, visit);
+    }
+
+    std::size_t _dims = 0;
+    std::vector<Node> _nodes;
+    std::vector<std::uint32_t> _order;
+    // points with a non finite coordinate, kept out of the tree
+    std::vector<std::uint32_t> _unindexed;
+};
+
+}// namespace ruleextraction
+}// namespace hx
\ No newline at end of file
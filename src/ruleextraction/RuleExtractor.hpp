@@ -1,9 +1,13 @@
 #pragma once
 
+#include "memory/AllocationTracker.hpp"
+#include "memory/NumaStorage.hpp"
+#include "memory/Resource.hpp"
 #include "memory/Utils.hpp"
 #include "optimisation/discrete/GeneticAlgorithm.hpp"
 #include "ruleextraction/RuleSolution.hpp"
 
+#include <stdexcept>
 #include <vector>
 
 namespace hx {
@@ -17,23 +21,33 @@ public:
                         hx::memory::Storage *controlStorage,
                         std::vector<std::size_t> &ruleClasses,
                         std::vector<std::size_t> &controlClasses,
-                        std::default_random_engine &randomness)
+                        std::default_random_engine &randomness,
+                        std::pmr::memory_resource *resource = nullptr,
+                        const PointIndex *controlIndex = nullptr,
+                        ScoringEngine engine = ScoringEngine::COVERAGE)
         : _dim(dim)
         , _stride(stride)
         , _ruleStorage(ruleStorage)
         , _controlStorage(controlStorage)
         , _ruleClasses(ruleClasses)
         , _controlClasses(controlClasses)
-        , _randomness(randomness) {}
+        , _randomness(randomness)
+        , _resource(resource)
+        , _controlIndex(controlIndex)
+        , _engine(engine) {}
 
     hx::ruleextraction::RuleSolution operator()() {
-        return hx::ruleextraction::RuleSolution(this->_dim,
-                                                this->_stride,
-                                                this->_ruleStorage,
-                                                this->_controlStorage,
-                                                this->_controlClasses,
-                                                this->_ruleClasses,
-                                                this->_randomness);
+        hx::ruleextraction::RuleSolution solution(this->_dim,
+                                                  this->_stride,
+                                                  this->_ruleStorage,
+                                                  this->_controlStorage,
+                                                  this->_controlClasses,
+                                                  this->_ruleClasses,
+                                                  this->_randomness,
+                                                  this->_resource,
+                                                  this->_controlIndex);
+        solution.setScoringEngine(this->_engine);
+        return solution;
     }
 
 private:
@@ -45,6 +59,9 @@ private:
     std::vector<std::size_t> &_ruleClasses;
     std::vector<std::size_t> &_controlClasses;
     std::default_random_engine &_randomness;
+    std::pmr::memory_resource *_resource;
+    const PointIndex *_controlIndex;
+    ScoringEngine _engine;
 };
 
 using GeneticAlgorithmBase =
@@ -101,32 +118,68 @@ public:
                   std::vector<std::size_t> controlPointsClasses,
                   std::vector<std::size_t> rulePointsClasses,
                   double crossoverFactor = 0.33,
-                  double mutationFactor = 0.1)
+                  double mutationFactor = 0.1,
+                  ScoringEngine engine = ScoringEngine::COVERAGE)
         : _randomness(std::random_device()())
         , _dims(dims)
         , _strides(hx::memory::value_padding<8>(_dims))
+        , _scoringEngine(engine)
         , _controlPointsClasses(std::move(controlPointsClasses))
         , _rulePointsClasses(std::move(rulePointsClasses))
-        , _ruleCentres(_strides * _rulePointsClasses.size() * sizeof(float))
-        , _controlPoints(_strides * _controlPointsClasses.size() * sizeof(float)) {
-        this->_pImpl = std::make_unique<hx::ruleextraction::RuleOptimisator>(
-            population,
-            this->_strides,
-            this->_rulePointsClasses.size(),
-            crossoverFactor,
-            mutationFactor,
-            RuleSolutionFactory(this->_dims,
-                                this->_strides,
-                                &this->_ruleCentres,
-                                &this->_controlPoints,
-                                this->_rulePointsClasses,
-                                this->_controlPointsClasses,
-                                this->_randomness),
-            _randomness);
+        // every scoring worker reads all points, so they are spread over the nodes
+        , _ruleCentres(hx::memory::mapNuma(_strides * _rulePointsClasses.size()
+                                               * sizeof(float),
+                                           hx::memory::NumaPolicy::INTERLEAVED))
+        , _controlPoints(hx::memory::mapNuma(_strides * _controlPointsClasses.size()
+                                                 * sizeof(float),
+                                             hx::memory::NumaPolicy::INTERLEAVED)) {
+        this->_trackPoints();
+        this->_createOptimisator(population, crossoverFactor, mutationFactor);
+    };
+
+    // Works on control points already laid out in `controlPoints`, rows padded to
+    // getStride() floats, e.g. a shared memory segment mapped by several processes.
+    // The points are only read, the storage may be a read only mapping.
+    RuleExtractor(std::size_t population,
+                  std::size_t dims,
+                  std::vector<std::size_t> controlPointsClasses,
+                  std::vector<std::size_t> rulePointsClasses,
+                  hx::memory::Storage controlPoints,
+                  double crossoverFactor = 0.33,
+                  double mutationFactor = 0.1,
+                  ScoringEngine engine = ScoringEngine::COVERAGE)
+        : _randomness(std::random_device()())
+        , _dims(dims)
+        , _strides(hx::memory::value_padding<8>(_dims))
+        , _scoringEngine(engine)
+        , _controlPointsClasses(std::move(controlPointsClasses))
+        , _rulePointsClasses(std::move(rulePointsClasses))
+        , _ruleCentres(hx::memory::mapNuma(_strides * _rulePointsClasses.size()
+                                               * sizeof(float),
+                                           hx::memory::NumaPolicy::INTERLEAVED))
+        , _controlPoints(std::move(controlPoints))
+        , _controlPointsExternal(true) {
+        if (this->_controlPoints.size()
+            < _strides * _controlPointsClasses.size() * sizeof(float))
+            throw std::invalid_argument("Control points storage is too small");
+
+        this->_trackPoints();
+        this->_createOptimisator(population, crossoverFactor, mutationFactor);
     };
 
     float *getRulesCentres() { return this->_ruleCentres.get_as<float>(); }
-    float *getControlCentres() { return this->_controlPoints.get_as<float>(); }
+    // writing the points through the returned pointer is fine until the first
+    // fitEpoch(), which indexes them; points supplied to the constructor are read
+    // only, they are reached through the const overload
+    float *getControlCentres() {
+        if (this->_controlPointsExternal)
+            throw std::logic_error("Control points supplied by the caller are read only");
+        this->_controlIndexStale = true;
+        return this->_controlPoints.get_as<float>();
+    }
+    const float *getControlCentres() const {
+        return this->_controlPoints.get_as<float>();
+    }
 
     std::size_t getStride() const { return this->_strides; }
     std::size_t getDims() const { return this->_dims; }
@@ -134,22 +187,79 @@ public:
         return this->_controlPointsClasses.size();
     }
     std::size_t getRulesNumber() const { return this->_rulePointsClasses.size(); }
-    std::size_t fitEpoch() { return _pImpl->fitEpoch(); }
+    std::size_t fitEpoch() {
+        if (this->_controlIndexStale) this->_indexControlPoints();
+        return _pImpl->fitEpoch();
+    }
     float *getBest() { return _pImpl->getBest().getData(); }
 
     std::size_t *ruleClasses() { return _rulePointsClasses.data(); }
 
+    // "rule_centres", "control_points" and "population", the latter being what the
+    // solution pool draws from the heap, not the size of the live solutions
+    const hx::memory::AllocationTracker &getAllocationTracker() const {
+        return this->_allocationTracker;
+    }
+
 private:
+    void _trackPoints() {
+        this->_ruleCentres.track(this->_allocationTracker.counters("rule_centres"));
+        this->_controlPoints.track(this->_allocationTracker.counters("control_points"));
+    }
+
+    // the points are usually copied in after construction, so they are indexed on
+    // first use; in high dimensions the index stays disabled and scoring scans them
+    void _indexControlPoints() {
+        this->_controlIndex.build(this->_controlPoints.get_as<float>(),
+                                  this->_controlPointsClasses.size(),
+                                  this->_dims,
+                                  this->_strides);
+        this->_controlIndexStale = false;
+    }
+
+    void _createOptimisator(std::size_t population,
+                            double crossoverFactor,
+                            double mutationFactor) {
+        this->_pImpl = std::make_unique<hx::ruleextraction::RuleOptimisator>(
+            population,
+            this->_strides,
+            this->_rulePointsClasses.size(),
+            crossoverFactor,
+            mutationFactor,
+            RuleSolutionFactory(this->_dims,
+                                this->_strides,
+                                &this->_ruleCentres,
+                                &this->_controlPoints,
+                                this->_rulePointsClasses,
+                                this->_controlPointsClasses,
+                                this->_randomness,
+                                &this->_solutionResource,
+                                &this->_controlIndex,
+                                this->_scoringEngine),
+            _randomness);
+    }
+
     std::default_random_engine _randomness;
     std::size_t _dims;
     std::size_t _strides;
+    ScoringEngine _scoringEngine;
 
     std::vector<std::size_t> _controlPointsClasses;
     std::vector<std::size_t> _rulePointsClasses;
 
+    // outlives every storage it counts
+    hx::memory::AllocationTracker _allocationTracker;
+
     hx::memory::Storage _ruleCentres;
     hx::memory::Storage _controlPoints;
+    bool _controlPointsExternal = false;
+    PointIndex _controlIndex;
+    bool _controlIndexStale = true;
 
+    // rule boxes of every solution, has to outlive the optimisator
+    hx::memory::TrackingResource _solutionUpstream{
+        _allocationTracker.counters("population")};
+    hx::memory::PoolResource _solutionResource{&_solutionUpstream};
     std::unique_ptr<hx::ruleextraction::RuleOptimisator> _pImpl;
 };
 }// namespace ruleextraction
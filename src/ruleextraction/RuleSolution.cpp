@@ -1,138 +1,319 @@
 #include "ruleextraction/RuleSolution.hpp"
+#include "ruleextraction/Hyperrect.hpp"
 
 #include <algorithm>
 #include <iostream>
+#include <map>
+#include <utility>
 
 namespace hx {
 namespace ruleextraction {
 
 namespace {
-enum class RuleSolutionStatus : uint8_t {
-    UNMARKED = 0x00,
-    MARKED = 0x01,
-    WRONG = 0x02,
-    OVERLAPPED = 0x03
-};
-
-bool insideHyperrect(const float *controlPoint,
-                     const float *centerPoints,
-                     const float *lowerBounds,
-                     const float *upperBounds,
-                     std::size_t dims) {
-    for (std::size_t i = 0; i < dims;
-         ++i, ++controlPoint, ++centerPoints, ++lowerBounds, ++upperBounds) {
-        if (*controlPoint < *centerPoints - *lowerBounds
-            || *controlPoint > *centerPoints + *upperBounds)
-            return false;
-    }
+// energy of a control point: 0 when a single rule of its class covers it, 2 when
+// rules overlap on it, 1 when uncovered or covered by a rule of another class
+std::size_t pointEnergy(std::uint32_t rules, std::uint32_t matching) {
+    if (rules > 1) return 2;
+    return rules == 1 && matching == 1 ? 0 : 1;
+}
+
+}// namespace
 
-    return true;
+float &RuleSolution::writeBox(std::size_t index) {
+    float *boxes = this->_ruleBoxes.get_as<float>();
+    this->_undo[this->_undoSize++] = {index, boxes[index]};
+    return boxes[index];
 }
 
-RuleSolutionStatus controlPointStatus(const float *controlPoint,
-                                      const float *centerPoints,
-                                      const float *lowerBounds,
-                                      const float *upperBounds,
-                                      const std::size_t *ruleClasses,
-                                      std::size_t controlClass,
-                                      std::size_t rulesSize,
-                                      std::size_t dims,
-                                      std::size_t stride) {
-    RuleSolutionStatus result = RuleSolutionStatus::UNMARKED;
-    for (std::size_t i = 0; i < rulesSize; ++i) {
-        if (insideHyperrect(controlPoint, centerPoints, lowerBounds, upperBounds, dims)) {
-            auto classesMatch = (*ruleClasses == controlClass);
-            if (result == RuleSolutionStatus::UNMARKED)
-                result =
-                    classesMatch ? RuleSolutionStatus::MARKED : RuleSolutionStatus::WRONG;
-            else
-                return RuleSolutionStatus::OVERLAPPED;
-        }
+void RuleSolution::undoNeighbouring_() {
+    if (this->_coverageValid) this->coverLastMove(true);
+    this->markTouchedRules();
 
-        centerPoints += stride;
-        lowerBounds += stride * 2;
-        upperBounds += stride * 2;
-        ++ruleClasses;
+    float *boxes = this->_ruleBoxes.get_as<float>();
+    // newest first, a move may write the same entry twice
+    while (this->_undoSize > 0) {
+        const auto &[index, value] = this->_undo[--this->_undoSize];
+        boxes[index] = value;
     }
-
-    return result;
 }
 
-}// namespace
-
 void RuleSolution::neighbouring_() {
     std::uniform_int_distribution<> ruleDist(0, 2 * this->_size - 1);
     std::uniform_int_distribution<> dimsDist(0, this->_dims - 1);
     std::uniform_int_distribution<> mode(0, 2);
     std::uniform_real_distribution<> changeDist(0.5, 1.5);
 
+    // only the last move can be undone
+    this->_undoSize = 0;
+
     std::size_t r1i, r2i, r1d, r2d, d1, d2;
     double change;
-    switch (mode(this->_randomness)) {
+    switch (mode(*this->_randomness)) {
         case 0:
             // switch dimensions
-            r1i = ruleDist(this->_randomness);
+            r1i = ruleDist(*this->_randomness);
             r2i = r1i & 0x01 ? r1i - 1 : r1i + 1;
-            d1 = dimsDist(this->_randomness);
-            d2 = dimsDist(this->_randomness);
+            d1 = dimsDist(*this->_randomness);
+            d2 = dimsDist(*this->_randomness);
 
-            std::iter_swap(this->_ruleBoxes.get_as<float>() + this->_stride * r1i + d1,
-                           this->_ruleBoxes.get_as<float>() + this->_stride * r1i + d2);
-            std::iter_swap(this->_ruleBoxes.get_as<float>() + this->_stride * r2i + d1,
-                           this->_ruleBoxes.get_as<float>() + this->_stride * r2i + d2);
+            std::swap(this->writeBox(this->_stride * r1i + d1),
+                      this->writeBox(this->_stride * r1i + d2));
+            std::swap(this->writeBox(this->_stride * r2i + d1),
+                      this->writeBox(this->_stride * r2i + d2));
             break;
 
         case 1:
-            r1i = ruleDist(this->_randomness);
+            r1i = ruleDist(*this->_randomness);
             r2i = r1i & 0x01 ? r1i - 1 : r1i + 1;
-            d1 = dimsDist(this->_randomness);
-            change = changeDist(this->_randomness);
+            d1 = dimsDist(*this->_randomness);
+            change = changeDist(*this->_randomness);
 
-            this->_ruleBoxes.get_as<float>()[this->_stride * r1i + d1] *= change;
-            this->_ruleBoxes.get_as<float>()[this->_stride * r2i + d1] *= change;
+            this->writeBox(this->_stride * r1i + d1) *= change;
+            this->writeBox(this->_stride * r2i + d1) *= change;
             break;
 
         case 2:
-            r1i = ruleDist(this->_randomness);
+            r1i = ruleDist(*this->_randomness);
             r2i = r1i & 0x01 ? r1i - 1 : r1i + 1;
-            r1d = ruleDist(this->_randomness);
+            r1d = ruleDist(*this->_randomness);
             r2d = r1d & 0x01 ? r1d - 1 : r1d + 1;
-            d1 = dimsDist(this->_randomness);
-            d2 = dimsDist(this->_randomness);
+            d1 = dimsDist(*this->_randomness);
+            d2 = dimsDist(*this->_randomness);
 
-            std::iter_swap(this->_ruleBoxes.get_as<float>() + this->_stride * r1i + d1,
-                           this->_ruleBoxes.get_as<float>() + this->_stride * r1d + d2);
-            std::iter_swap(this->_ruleBoxes.get_as<float>() + this->_stride * r2i + d2,
-                           this->_ruleBoxes.get_as<float>() + this->_stride * r2d + d1);
+            std::swap(this->writeBox(this->_stride * r1i + d1),
+                      this->writeBox(this->_stride * r1d + d2));
+            std::swap(this->writeBox(this->_stride * r2i + d2),
+                      this->writeBox(this->_stride * r2d + d1));
             break;
 
         default:
             return;
     }
+
+    if (this->_coverageValid) this->coverLastMove(false);
+    this->markTouchedRules();
 }
 
-std::size_t RuleSolution::scoreSolution() const {
-    std::size_t energy = this->_controlClasses.size();
-    const auto *controlPoint = this->_controlPoints->get_as<float>();
-
-    for (std::size_t i = 0; i < this->_controlClasses.size(); ++i) {
-        RuleSolutionStatus status =
-            controlPointStatus(controlPoint,
-                               this->_ruleCentres->get_as<float>(),
-                               this->_ruleBoxes.get_as<float>(),
-                               this->_ruleBoxes.get_as<float>() + this->_stride,
-                               this->_ruleClasses.data(),
-                               this->_controlClasses[i],
-                               this->_size,
-                               this->_dims,
-                               this->_stride);
-        if (status == RuleSolutionStatus::MARKED)
-            --energy;
-        else if (status == RuleSolutionStatus::OVERLAPPED)
-            ++energy;
+template <typename Visitor>
+void RuleSolution::forEachControlPoint(const float *low,
+                                       const float *high,
+                                       Visitor &&visit) const {
+    if (this->_controlIndex && this->_controlIndex->enabled())
+        return this->_controlIndex->forEachCandidate(low, high, visit);
+
+    for (std::size_t i = 0; i < this->_controlClasses.size(); ++i)
+        visit(i);
+}
+
+std::size_t RuleSolution::touchedRules(std::array<std::size_t, 4> &rules) const {
+    const std::size_t ruleFloats = 2 * this->_stride;
+    std::size_t touched = 0;
+    for (std::size_t i = 0; i < this->_undoSize; ++i) {
+        const std::size_t rule = this->_undo[i].first / ruleFloats;
+        if (std::find(rules.begin(), rules.begin() + touched, rule)
+            == rules.begin() + touched)
+            rules[touched++] = rule;
+    }
+    return touched;
+}
+
+void RuleSolution::ruleBounds(std::size_t rule, float *box) const {
+    const float *centre = this->_ruleCentres->get_as<float>() + rule * this->_stride;
+    const float *lower = this->_ruleBoxes.get_as<float>() + 2 * rule * this->_stride;
+    const float *upper = lower + this->_stride;
+    for (std::size_t d = 0; d < this->_dims; ++d) {
+        box[d] = centre[d] - lower[d];
+        box[this->_dims + d] = centre[d] + upper[d];
+    }
+}
+
+void RuleSolution::buildCoverage() const {
+    const auto *controlPoints = this->_controlPoints->get_as<float>();
+    const auto *centres = this->_ruleCentres->get_as<float>();
+    const auto *boxes = this->_ruleBoxes.get_as<float>();
+
+    this->_coverage.assign(this->_controlClasses.size(), Coverage());
+    this->_queryBox.resize(2 * this->_dims);
+    const float *low = this->_queryBox.data();
+    withHyperrectKernel([&](auto inside) {
+        for (std::size_t r = 0; r < this->_size; ++r) {
+            const float *centre = centres + r * this->_stride;
+            const float *lower = boxes + 2 * r * this->_stride;
+            const float *upper = lower + this->_stride;
+            this->ruleBounds(r, this->_queryBox.data());
+
+            this->forEachControlPoint(low, low + this->_dims, [&](std::size_t i) {
+                const float *controlPoint = controlPoints + i * this->_stride;
+                if (inside(controlPoint, centre, lower, upper, this->_dims)) {
+                    ++this->_coverage[i].rules;
+                    this->_coverage[i].matching +=
+                        this->_ruleClasses[r] == this->_controlClasses[i];
+                }
+            });
+        }
+    });
+
+    this->_energy = 0;
+    for (const auto &coverage : this->_coverage)
+        this->_energy += pointEnergy(coverage.rules, coverage.matching);
+    this->_coverageValid = true;
+}
+
+void RuleSolution::coverLastMove(bool undo) {
+    const std::size_t ruleFloats = 2 * this->_stride;
+    const float *boxes = this->_ruleBoxes.get_as<float>();
+    this->_previousRule.resize(ruleFloats);
+
+    std::array<std::size_t, 4> rules;
+    const std::size_t touched = this->touchedRules(rules);
+    for (std::size_t t = 0; t < touched; ++t) {
+        const std::size_t rule = rules[t];
+        const float *current = boxes + rule * ruleFloats;
+
+        // the rule as it was before the move, the undo log restored newest first
+        std::copy(current, current + ruleFloats, this->_previousRule.begin());
+        for (std::size_t i = this->_undoSize; i-- > 0;) {
+            const auto &[index, value] = this->_undo[i];
+            if (index / ruleFloats == rule)
+                this->_previousRule[index - rule * ruleFloats] = value;
+        }
+
+        if (undo)
+            this->moveRule(rule, current, this->_previousRule.data());
+        else
+            this->moveRule(rule, this->_previousRule.data(), current);
     }
+}
+
+void RuleSolution::moveRule(std::size_t rule, const float *from, const float *to) {
+    const auto *controlPoints = this->_controlPoints->get_as<float>();
+    const auto *centre = this->_ruleCentres->get_as<float>() + rule * this->_stride;
+    const auto dims = this->_dims;
+    const auto stride = this->_stride;
+
+    // the points that may change are the ones in either box
+    this->_queryBox.resize(2 * dims);
+    for (std::size_t d = 0; d < dims; ++d) {
+        this->_queryBox[d] = centre[d] - std::max(from[d], to[d]);
+        this->_queryBox[dims + d] =
+            centre[d] + std::max(from[stride + d], to[stride + d]);
+    }
+
+    const float *low = this->_queryBox.data();
+    withHyperrectKernel([&](auto inside) {
+        this->forEachControlPoint(low, low + dims, [&](std::size_t i) {
+            const float *controlPoint = controlPoints + i * stride;
+            const bool before = inside(controlPoint, centre, from, from + stride, dims);
+            const bool after = inside(controlPoint, centre, to, to + stride, dims);
+            if (before == after) return;
+
+            auto &coverage = this->_coverage[i];
+            const bool matches = this->_ruleClasses[rule] == this->_controlClasses[i];
+            this->_energy -= pointEnergy(coverage.rules, coverage.matching);
+            if (after) {
+                ++coverage.rules;
+                coverage.matching += matches;
+            } else {
+                --coverage.rules;
+                coverage.matching -= matches;
+            }
+            this->_energy += pointEnergy(coverage.rules, coverage.matching);
+        });
+    });
+}
+
+void RuleSolution::markTouchedRules() {
+    if (this->_engine != ScoringEngine::BITSET || !this->_ruleBitsValid) return;
+
+    std::array<std::size_t, 4> rules;
+    const std::size_t touched = this->touchedRules(rules);
+    for (std::size_t t = 0; t < touched; ++t)
+        this->_ruleDirty[rules[t]] = 1;
+}
+
+void RuleSolution::scanRule(std::size_t rule) const {
+    const std::size_t words = (this->_controlClasses.size() + 63) / 64;
+    std::uint64_t *bits = this->_ruleBits.data() + rule * words;
+    std::fill(bits, bits + words, 0);
+
+    const auto *controlPoints = this->_controlPoints->get_as<float>();
+    const float *centre = this->_ruleCentres->get_as<float>() + rule * this->_stride;
+    const float *lower = this->_ruleBoxes.get_as<float>() + 2 * rule * this->_stride;
+    const float *upper = lower + this->_stride;
+
+    this->_queryBox.resize(2 * this->_dims);
+    const float *low = this->_queryBox.data();
+    this->ruleBounds(rule, this->_queryBox.data());
+    withHyperrectKernel([&](auto inside) {
+        this->forEachControlPoint(low, low + this->_dims, [&](std::size_t i) {
+            const float *controlPoint = controlPoints + i * this->_stride;
+            if (inside(controlPoint, centre, lower, upper, this->_dims))
+                bits[i / 64] |= std::uint64_t(1) << (i % 64);
+        });
+    });
+}
+
+std::size_t RuleSolution::scoreBitsets() const {
+    const std::size_t points = this->_controlClasses.size();
+    const std::size_t words = (points + 63) / 64;
+
+    if (!this->_classMasks) {
+        auto masks = std::make_shared<ClassMasks>();
+        std::map<std::size_t, std::size_t> rows;
+        for (auto ruleClass : this->_ruleClasses)
+            masks->ruleRow.push_back(
+                rows.try_emplace(ruleClass, rows.size()).first->second);
+
+        masks->bits.assign(rows.size() * words, 0);
+        for (std::size_t i = 0; i < points; ++i) {
+            auto row = rows.find(this->_controlClasses[i]);
+            if (row != rows.end())
+                masks->bits[row->second * words + i / 64] |= std::uint64_t(1) << (i % 64);
+        }
+        this->_classMasks = std::move(masks);
+    }
+
+    if (!this->_ruleBitsValid) {
+        this->_ruleBits.assign(this->_size * words, 0);
+        this->_ruleDirty.assign(this->_size, 1);
+        this->_ruleBitsValid = true;
+    }
+    for (std::size_t r = 0; r < this->_size; ++r) {
+        if (!this->_ruleDirty[r]) continue;
+        this->scanRule(r);
+        this->_ruleDirty[r] = 0;
+    }
+
+    // points covered at least once, at least twice and by a rule of their class
+    this->_aggregate.assign(3 * words, 0);
+    std::uint64_t *any = this->_aggregate.data();
+    std::uint64_t *twice = any + words;
+    std::uint64_t *matched = twice + words;
+    for (std::size_t r = 0; r < this->_size; ++r) {
+        const std::uint64_t *bits = this->_ruleBits.data() + r * words;
+        const std::uint64_t *mask =
+            this->_classMasks->bits.data() + this->_classMasks->ruleRow[r] * words;
+        for (std::size_t w = 0; w < words; ++w) {
+            twice[w] |= any[w] & bits[w];
+            any[w] |= bits[w];
+            matched[w] |= bits[w] & mask[w];
+        }
+    }
+
+    // a point is marked when covered once, by a rule of its class
+    std::size_t marked = 0, overlapped = 0;
+    for (std::size_t w = 0; w < words; ++w) {
+        marked += __builtin_popcountll(matched[w] & ~twice[w]);
+        overlapped += __builtin_popcountll(twice[w]);
+    }
+    return points - marked + overlapped;
+}
+
+std::size_t RuleSolution::scoreSolution() const {
+    if (this->_engine == ScoringEngine::BITSET) return this->scoreBitsets();
 
-    return energy;
+    if (!this->_coverageValid) this->buildCoverage();
+    return this->_energy;
 }
 
 }// namespace ruleextraction
@@ -3,13 +3,27 @@
 #include "optimisation/discrete/OptimisationSolution.hpp"
 
 #include "memory/Storage.hpp"
+#include "ruleextraction/PointIndex.hpp"
 
 #include <boost/align/aligned_allocator.hpp>
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <random>
+#include <utility>
+#include <vector>
 
 namespace hx {
 namespace ruleextraction {
+
+// How a RuleSolution finds its energy. COVERAGE keeps per control point counts
+// updated move by move. BITSET keeps a bitset of the covered points per rule,
+// rescans only the rules changed since the last scoring and adds the classes up with
+// popcounts; it takes rules * points / 8 bytes per solution.
+enum class ScoringEngine : uint8_t { COVERAGE, BITSET };
+
 class RuleSolution
     : public hx::optimisation::discrete::OptimisationSolution<std::size_t> {
 public:
@@ -19,58 +33,197 @@ public:
                  hx::memory::Storage *controlPoints,
                  const std::vector<std::size_t> &controlClasses,
                  const std::vector<std::size_t> &ruleClasses,
-                 std::default_random_engine &entropy)
+                 std::default_random_engine &entropy,
+                 std::pmr::memory_resource *resource = nullptr,
+                 const PointIndex *controlIndex = nullptr)
         : _dims(dims)
         , _stride(stride)
         , _size(ruleClasses.size())
-        , _ruleBoxes(2 * _stride * _size * sizeof(float),
-                     boost::alignment::aligned_allocator<float, 32>())
+        , _ruleBoxes(allocateRuleBoxes(2 * _stride * _size * sizeof(float), resource))
         , _ruleCentres(ruleCentres)
         , _controlPoints(controlPoints)
         , _ruleClasses(ruleClasses)
         , _controlClasses(controlClasses)
-        , _randomness(entropy) {
+        , _randomness(&entropy)
+        , _controlIndex(controlIndex) {
         std::normal_distribution<float> dist(0.0, 1.0);
 
         for (std::size_t i = 0; i < _size * 2; ++i) {
             for (std::size_t j = 0; j < _dims; ++j) {
                 auto current = this->_ruleBoxes.get_as<float>() + i * this->_stride + j;
-                *current = std::abs(dist(this->_randomness));
+                *current = std::abs(dist(*this->_randomness));
             }
         }
     };
 
+    // Copies share the boxes but not the scoring state, which is as large as the
+    // control points (or rules times points for the bitsets) and only pays off for a
+    // solution changed in place. The score is copied, a copy rebuilds the state only
+    // once it is changed and rescored.
     RuleSolution(const RuleSolution &rhs)
-        : _dims(rhs._dims)
+        : OptimisationSolution(rhs)
+        , _dims(rhs._dims)
         , _stride(rhs._stride)
         , _size(rhs._size)
-        , _ruleBoxes(rhs._ruleBoxes.copy())
+        , _ruleBoxes(rhs._ruleBoxes.share())
         , _ruleCentres(rhs._ruleCentres)
         , _controlPoints(rhs._controlPoints)
         , _ruleClasses(rhs._ruleClasses)
         , _controlClasses(rhs._controlClasses)
-        , _randomness(rhs._randomness) {}
+        , _randomness(rhs._randomness)
+        , _controlIndex(rhs._controlIndex)
+        , _engine(rhs._engine)
+        , _classMasks(rhs._classMasks) {}
+
+    // moves keep everything, e.g. replicas exchanging their chains
+    RuleSolution(RuleSolution &&rhs)
+        : OptimisationSolution(std::move(rhs))
+        , _dims(rhs._dims)
+        , _stride(rhs._stride)
+        , _size(rhs._size)
+        , _ruleBoxes(std::move(rhs._ruleBoxes))
+        , _ruleCentres(rhs._ruleCentres)
+        , _controlPoints(rhs._controlPoints)
+        , _ruleClasses(rhs._ruleClasses)
+        , _controlClasses(rhs._controlClasses)
+        , _randomness(rhs._randomness)
+        , _controlIndex(rhs._controlIndex)
+        , _undo(rhs._undo)
+        , _undoSize(rhs._undoSize)
+        , _coverage(std::move(rhs._coverage))
+        , _energy(rhs._energy)
+        , _coverageValid(std::exchange(rhs._coverageValid, false))
+        , _engine(rhs._engine)
+        , _classMasks(std::move(rhs._classMasks))
+        , _ruleBits(std::move(rhs._ruleBits))
+        , _ruleDirty(std::move(rhs._ruleDirty))
+        , _ruleBitsValid(std::exchange(rhs._ruleBitsValid, false)) {}
 
     virtual ~RuleSolution() = default;
 
     RuleSolution &operator=(const RuleSolution &rhs) {
+        // the cached score follows the boxes
+        OptimisationSolution::operator=(rhs);
+        this->_dims = rhs._dims;
+        this->_stride = rhs._stride;
+        this->_size = rhs._size;
+
+        // the boxes are copied lazily, on the first write through getData()
+        this->_ruleBoxes = rhs._ruleBoxes.share();
+        this->_ruleCentres = rhs._ruleCentres;
+        this->_controlPoints = rhs._controlPoints;
+        this->_controlIndex = rhs._controlIndex;
+        this->_undoSize = 0;
+
+        // the scoring state is dropped, as on copy construction
+        std::vector<Coverage>().swap(this->_coverage);
+        this->_coverageValid = false;
+        std::vector<std::uint64_t>().swap(this->_ruleBits);
+        this->_ruleBitsValid = false;
+
+        this->_engine = rhs._engine;
+        this->_classMasks = rhs._classMasks;
+
+        return *this;
+    }
+
+    RuleSolution &operator=(RuleSolution &&rhs) {
+        if (this == &rhs) return *this;
+
+        OptimisationSolution::operator=(std::move(rhs));
         this->_dims = rhs._dims;
         this->_stride = rhs._stride;
         this->_size = rhs._size;
 
-        this->_ruleBoxes = rhs._ruleBoxes.copy();
+        this->_ruleBoxes = std::move(rhs._ruleBoxes);
         this->_ruleCentres = rhs._ruleCentres;
         this->_controlPoints = rhs._controlPoints;
+        this->_controlIndex = rhs._controlIndex;
+        this->_undo = rhs._undo;
+        this->_undoSize = std::exchange(rhs._undoSize, 0);
+
+        this->_coverage = std::move(rhs._coverage);
+        this->_energy = rhs._energy;
+        this->_coverageValid = std::exchange(rhs._coverageValid, false);
+
+        this->_engine = rhs._engine;
+        this->_classMasks = std::move(rhs._classMasks);
+        this->_ruleBits = std::move(rhs._ruleBits);
+        this->_ruleDirty = std::move(rhs._ruleDirty);
+        this->_ruleBitsValid = std::exchange(rhs._ruleBitsValid, false);
 
         return *this;
     }
 
-    float *getData() { return _ruleBoxes.get_as<float>(); }
+    // Engine the neighbouring draws from, shared by default with the extractor.
+    // Chains running concurrently need one each; it is kept on assignment.
+    void setRandomEngine(std::default_random_engine &entropy) { _randomness = &entropy; }
+
+    // writing through the returned pointer makes the coverage stale, so it is
+    // rebuilt by the next scoring
+    float *getData() {
+        _coverageValid = false;
+        _ruleBitsValid = false;
+        return _ruleBoxes.get_as<float>();
+    }
     const float *getData() const { return _ruleBoxes.get_as<float>(); }
 
+    // moves only keep the state of the engine in use, the other one is rebuilt
+    void setScoringEngine(ScoringEngine engine) {
+        if (engine != this->_engine) {
+            this->_coverageValid = false;
+            this->_ruleBitsValid = false;
+        }
+        this->_engine = engine;
+        this->invalidateScore();
+    }
+    ScoringEngine getScoringEngine() const { return this->_engine; }
+
+    // a move writes at most four box entries, their old values are kept to undo it
+    bool supportsUndo() const noexcept override { return true; }
+
 private:
+    constexpr static std::size_t RULE_BOXES_ALIGNMENT = 32;
+
+    static hx::memory::Storage allocateRuleBoxes(std::size_t size_in_bytes,
+                                                 std::pmr::memory_resource *resource) {
+        if (resource)
+            return hx::memory::Storage(size_in_bytes, resource, RULE_BOXES_ALIGNMENT);
+        return hx::memory::Storage(
+            size_in_bytes,
+            boost::alignment::aligned_allocator<float, RULE_BOXES_ALIGNMENT>());
+    }
+
     std::size_t scoreSolution() const override;
     void neighbouring_() override;
+    void undoNeighbouring_() override;
+    void commitNeighbouring_() override { this->_undoSize = 0; }
+
+    // entry of the boxes about to be written by a move, its value is remembered
+    float &writeBox(std::size_t index);
+
+    // rules covering a control point and how many of them share its class
+    struct Coverage {
+        std::uint32_t rules = 0;
+        std::uint32_t matching = 0;
+    };
+
+    // the rules whose boxes the last move wrote, at most four
+    std::size_t touchedRules(std::array<std::size_t, 4> &rules) const;
+    // box of `rule` as `dims` lower then `dims` upper coordinates
+    void ruleBounds(std::size_t rule, float *box) const;
+
+    void buildCoverage() const;
+    // updates the coverage for the rules touched by the last move, or by its undo
+    void coverLastMove(bool undo);
+    void moveRule(std::size_t rule, const float *from, const float *to);
+    std::size_t scoreBitsets() const;
+    void scanRule(std::size_t rule) const;
+    void markTouchedRules();
+
+    // calls `visit(point)` for the control points that may lie in low <= x <= high
+    template <typename Visitor>
+    void forEachControlPoint(const float *low, const float *high, Visitor &&visit) const;
 
     std::size_t _dims;
     std::size_t _stride;
@@ -82,7 +235,36 @@ private:
 
     const std::vector<std::size_t> &_ruleClasses;
     const std::vector<std::size_t> &_controlClasses;
-    std::default_random_engine &_randomness;
+    std::default_random_engine *_randomness;
+    // k-d tree over the control points, shared by the population, if any
+    const PointIndex *_controlIndex;
+
+    std::array<std::pair<std::size_t, float>, 4> _undo;
+    std::size_t _undoSize = 0;
+
+    // Per control point coverage and the energy it adds up to. A move only
+    // rescans the points against the rules it touched.
+    mutable std::vector<Coverage> _coverage;
+    mutable std::size_t _energy = 0;
+    mutable bool _coverageValid = false;
+    std::vector<float> _previousRule;
+    // bounds of the box a scan visits the control points of
+    mutable std::vector<float> _queryBox;
+
+    // bitsets of the control points of each class, shared between copies; every rule
+    // uses the row of its own class
+    struct ClassMasks {
+        std::vector<std::uint64_t> bits;
+        std::vector<std::size_t> ruleRow;
+    };
+
+    ScoringEngine _engine = ScoringEngine::COVERAGE;
+    mutable std::shared_ptr<const ClassMasks> _classMasks;
+    // per rule bitsets of the covered points, one row of words per rule
+    mutable std::vector<std::uint64_t> _ruleBits;
+    mutable std::vector<std::uint8_t> _ruleDirty;
+    mutable bool _ruleBitsValid = false;
+    mutable std::vector<std::uint64_t> _aggregate;
 };
 }// namespace ruleextraction
 }// namespace hx
\ No newline at end of file
@@ -2,9 +2,12 @@
 #include <stdexcept>
 
 #include <bitset>
+#include <random>
 #include <unordered_map>
 
 #include "automata/DFA.hpp"
+#include "automata/DFAScanner.hpp"
+#include "automata/NFA.hpp"
 #include "automata/TransitionFunction.hpp"
 
 template <typename T, typename BaseType>
@@ -102,4 +105,630 @@ TEST(AutomataTest, ExemplaryAutomata_Beg1BinDiv5) {
 
     dfa.compile(hx::DFA::flags::REDUCE_STATE_TABLE);
     performAutomataTest(dfa, testStrings, correct, 6, '0');
+}
+
+TEST(AutomataTest, DFAScanner_AcceptOffsets) {
+    // unanchored search for "ab" over the whole byte alphabet
+    hx::DFA dfa(
+        [](std::size_t state, std::size_t action) -> std::size_t {
+            if (action == 'a') return 1;
+            return state == 1 && action == 'b' ? 2 : 0;
+        },
+        0,
+        {2},
+        3,
+        256);
+    hx::DFAScanner scanner(dfa);
+
+    ASSERT_TRUE(scanner.isAccelerated(0));
+    ASSERT_FALSE(scanner.isAccelerated(1));
+    ASSERT_FALSE(scanner.isAccelerated(2));
+
+    std::string input(1000, 'x');
+    input.replace(3, 2, "ab");
+    input.replace(100, 3, "aab");
+    input.replace(998, 2, "ab");
+    input[500] = 'a';
+
+    std::vector<std::size_t> expected;
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        dfa.process(static_cast<std::uint8_t>(input[i]));
+        if (dfa.isFinal()) expected.push_back(i);
+    }
+
+    auto data = reinterpret_cast<const std::uint8_t *>(input.data());
+    std::vector<std::size_t> offsets;
+    ASSERT_EQ(scanner.scan(data, data + input.size(), offsets), 2u);
+    ASSERT_EQ(offsets, expected);
+    ASSERT_EQ(offsets, std::vector<std::size_t>({4, 102, 999}));
+}
+
+TEST(AutomataTest, DFAScanner_StuckAutomata) {
+    hx::TransitionFunctionMap::ContainerMap map = {
+        {{0, 'a'}, 1}, {{1, 'b'}, 2}, {{2, 'a'}, 1}};
+    hx::DFA dfa(map, 0, {2});
+    hx::DFAScanner scanner(dfa);
+
+    std::string input = "ababxab";
+    auto data = reinterpret_cast<const std::uint8_t *>(input.data());
+    std::vector<std::size_t> offsets;
+
+    ASSERT_EQ(scanner.scan(data, data + input.size(), offsets), hx::DFA::INVALID_STATE);
+    ASSERT_EQ(offsets, std::vector<std::size_t>({1, 3}));
+}
+
+TEST(AutomataTest, ShuffleTable_SmallAutomata) {
+    // remainder of a decimal number modulo 7, accepts multiples of 7
+    hx::DFA dfa([](std::size_t state,
+                   std::size_t action) -> std::size_t { return (state * 10 + action) % 7; },
+                0,
+                {0},
+                7,
+                10);
+    std::vector<std::uint8_t> digits;
+    std::default_random_engine randomness(1234);
+    std::uniform_int_distribution<int> digit(0, 9);
+    for (std::size_t i = 0; i < 1000; ++i)
+        digits.push_back(digit(randomness));
+
+    auto expected = dfa.process(digits.begin(), digits.end());
+
+    dfa.compile(hx::DFA::flags::REDUCE_STATE_TABLE);
+    ASSERT_EQ(dfa.getTransitionFunction().getType(), hx::TransitionType::SHUFFLE);
+    ASSERT_EQ(dfa.process(digits.data(), digits.data() + digits.size()), expected);
+
+    dfa.reset();
+    ASSERT_EQ(dfa.process(digits.begin(), digits.end()), expected);
+}
+
+TEST(AutomataTest, ShuffleTable_FallbackToTable) {
+    hx::DFA dfa([](std::size_t state,
+                   std::size_t action) -> std::size_t { return (state + action) % 17; },
+                0,
+                {16},
+                17,
+                2);
+    dfa.compile(hx::DFA::flags::CREATE_DYNAMIC_TABLE | hx::DFA::flags::REDUCE_STATE_TABLE);
+    ASSERT_EQ(dfa.getTransitionFunction().getType(), hx::TransitionType::TABLE);
+
+    std::vector<std::uint8_t> input(16, 1);
+    dfa.process(input.data(), input.data() + input.size());
+    ASSERT_TRUE(dfa.isFinal());
+}
+
+TEST(AutomataTest, ReducedTable_UnreachableStates) {
+    // states 1 and 3 are never reached from 0
+    hx::TransitionFunctionMap::ContainerMap map = {{{0, 0}, 2},
+                                                   {{0, 1}, 4},
+                                                   {{1, 0}, 3},
+                                                   {{1, 1}, 1},
+                                                   {{2, 0}, 4},
+                                                   {{2, 1}, 0},
+                                                   {{3, 0}, 1},
+                                                   {{3, 1}, 3},
+                                                   {{4, 0}, 0},
+                                                   {{4, 1}, 2}};
+    hx::DFA dfa(map, 0, {4});
+    std::string testStrings[] = {"1", "00", "0", "0110", "10", "011"};
+    bool correct[] = {true, true, false, false, false, true};
+
+    performAutomataTest(dfa, testStrings, correct, 6, '0');
+
+    dfa.compile(hx::DFA::flags::CREATE_DYNAMIC_TABLE | hx::DFA::flags::REDUCE_STATE_TABLE);
+    performAutomataTest(dfa, testStrings, correct, 6, '0');
+}
+
+TEST(AutomataTest, NFA_ThirdSymbolFromEnd) {
+    // (0|1)*0(0|1)(0|1), its minimal DFA needs 8 states
+    hx::NFA::ContainerMap map = {{{0, 0}, {0, 1}},
+                                 {{0, 1}, {0}},
+                                 {{1, 0}, {2}},
+                                 {{1, 1}, {2}},
+                                 {{2, 0}, {3}},
+                                 {{2, 1}, {3}}};
+    hx::NFA nfa(map, {0}, {3});
+
+    std::default_random_engine randomness(4321);
+    std::uniform_int_distribution<std::size_t> symbol(0, 1);
+    std::vector<std::size_t> input;
+    for (std::size_t i = 0; i < 200; ++i) {
+        input.push_back(symbol(randomness));
+        nfa.process(input.back());
+        ASSERT_EQ(nfa.isFinal(), input.size() >= 3 && input[input.size() - 3] == 0);
+    }
+
+    nfa.reset();
+    nfa.process(input.begin(), input.end());
+    ASSERT_EQ(nfa.isFinal(), input[input.size() - 3] == 0);
+}
+
+TEST(AutomataTest, NFA_ShiftAndSequence) {
+    auto nfa = hx::NFA::fromSequence({{'a'}, {'b', 'c'}, {'d'}});
+    std::string text = "xxabdacdabcdxabd";
+    std::vector<std::size_t> found;
+
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (nfa.peekFinal(text[i])) found.push_back(i);
+        nfa.process(text[i]);
+    }
+    ASSERT_EQ(found, std::vector<std::size_t>({4, 7, 15}));
+
+    auto anchored = hx::NFA::fromSequence({{'a'}, {'b', 'c'}, {'d'}}, false);
+    std::string prefixed = "acdx", notPrefixed = "xacd";
+    anchored.process(prefixed.begin(), prefixed.begin() + 3);
+    ASSERT_TRUE(anchored.isFinal());
+    anchored.reset();
+    anchored.process(notPrefixed.begin(), notPrefixed.end());
+    ASSERT_FALSE(anchored.isFinal());
+}
+
+TEST(AutomataTest, ProcessBatch_MatchesSequential) {
+    hx::DFA dfa([](std::size_t state,
+                   std::size_t action) -> std::size_t { return (state * 2 + action) % 5; },
+                0,
+                {0},
+                5,
+                2);
+    hx::ThreadPool<> threadPool(4);
+
+    std::default_random_engine randomness(2468);
+    std::uniform_int_distribution<std::size_t> length(0, 40);
+    std::uniform_int_distribution<int> bit(0, 1);
+
+    std::vector<std::uint8_t> symbols;
+    std::vector<std::size_t> offsets = {0};
+    for (std::size_t i = 0; i < 5000; ++i) {
+        for (auto l = length(randomness); l > 0; --l)
+            symbols.push_back(bit(randomness));
+        offsets.push_back(symbols.size());
+    }
+
+    auto numberOfSequences = offsets.size() - 1;
+    std::uint8_t compileFlags[] = {
+        0, hx::DFA::flags::CREATE_DYNAMIC_TABLE, hx::DFA::flags::REDUCE_STATE_TABLE};
+    for (auto flags : compileFlags) {
+        dfa.compile(flags);
+
+        std::vector<std::size_t> finalStates(numberOfSequences);
+        std::vector<char> accepted(numberOfSequences);
+        auto acceptedCount = dfa.processBatch(symbols.data(),
+                                              offsets.data(),
+                                              numberOfSequences,
+                                              finalStates.data(),
+                                              accepted.data(),
+                                              threadPool);
+
+        std::size_t expectedCount = 0;
+        for (std::size_t i = 0; i < numberOfSequences; ++i) {
+            dfa.reset();
+            auto state = dfa.process(symbols.begin() + offsets[i],
+                                     symbols.begin() + offsets[i + 1]);
+            ASSERT_EQ(finalStates[i], state);
+            ASSERT_EQ(accepted[i], dfa.isFinal());
+            expectedCount += dfa.isFinal();
+        }
+        ASSERT_EQ(acceptedCount, expectedCount);
+    }
+}
+
+TEST(AutomataTest, DFACursor_SharedAutomata) {
+    hx::DFA dfa([](std::size_t state,
+                   std::size_t action) -> std::size_t { return (state * 2 + action) % 5; },
+                0,
+                {0},
+                5,
+                2);
+    dfa.compile(hx::DFA::flags::CREATE_DYNAMIC_TABLE);
+    const hx::DFA &sharedDfa = dfa;
+
+    std::vector<std::string> inputs = {"101", "1010", "1110", "11000", "0", "100101"};
+    std::vector<bool> expected = {true, true, false, false, true, false};
+
+    hx::ThreadPool<> threadPool(4);
+    auto results = threadPool
+                       .async_map(
+                           [&sharedDfa](std::size_t, std::string *input) -> bool {
+                               auto cursor = sharedDfa.cursor();
+                               for (auto c : *input)
+                                   cursor.process(c - '0');
+                               return cursor.isFinal();
+                           },
+                           inputs.begin(),
+                           inputs.end())
+                       .get();
+
+    for (std::size_t i = 0; i < inputs.size(); ++i)
+        ASSERT_EQ(results[i], expected[i]);
+
+    auto a = sharedDfa.cursor(), b = sharedDfa.cursor();
+    a.process(1);
+    ASSERT_EQ(a.getState(), 1);
+    ASSERT_EQ(b.getState(), 0);
+    a.reset();
+    ASSERT_EQ(a.getState(), 0);
+}
+
+TEST(AutomataTest, CompressedTable_SparseAutomata) {
+    // every state advances on one symbol and falls back to 0 or 1 otherwise,
+    // the last 100 states share one row
+    auto transition = [](std::size_t state, std::size_t action) -> std::size_t {
+        if (state >= 900) return action == 7 ? 0 : 900;
+        if (action == state % 256) return state + 1;
+        return action < 128 ? 0 : 1;
+    };
+    hx::DFA dfa(transition, 0, {900}, 1000, 256);
+    dfa.compile(hx::DFA::flags::COMPRESS_STATE_TABLE);
+
+    const auto &table = dfa.getTransitionFunction();
+    ASSERT_EQ(table.getType(), hx::TransitionType::COMPRESSED);
+    ASSERT_EQ(static_cast<const hx::TransitionFunctionTableCompressed &>(table)
+                  .getNumberOfRows(),
+              901);
+    ASSERT_LT(table.memorySize() * 2, sizeof(std::size_t) * 1000 * 256);
+
+    for (std::size_t state = 0; state < 1000; ++state) {
+        for (std::size_t action = 0; action < 256; ++action)
+            ASSERT_EQ(table.get(state, action), transition(state, action));
+    }
+}
+
+TEST(AutomataTest, CompressedTable_ChosenWhenSmaller) {
+    // four exceptions per state save about a third of the 2 MiB dense table, past
+    // the cache budget that is enough for the compressed one
+    auto transition = [](std::size_t state, std::size_t action) -> std::size_t {
+        for (std::size_t e = 0; e < 4; ++e) {
+            if (action == (state * 7 + e * 61) % 256)
+                return (state * 131 + e * 17) % 1024;
+        }
+        return (state + 1) % 1024;
+    };
+    hx::DFA dfa(transition, 0, {512}, 1024, 256);
+    dfa.compile(hx::DFA::flags::COMPRESS_STATE_TABLE);
+
+    const auto &table = dfa.getTransitionFunction();
+    const std::size_t denseSize = sizeof(std::size_t) * 1024 * 256;
+    ASSERT_EQ(table.getType(), hx::TransitionType::COMPRESSED);
+    ASSERT_LT(table.memorySize(), denseSize);
+    ASSERT_GT(table.memorySize() * 2, denseSize);
+
+    for (std::size_t state = 0; state < 1024; ++state) {
+        for (std::size_t action = 0; action < 256; ++action)
+            ASSERT_EQ(table.get(state, action), transition(state, action));
+    }
+}
+
+TEST(AutomataTest, CompressedTable_SmallAutomataStaysDense) {
+    hx::TransitionFunctionMap::ContainerMap map = {
+        {{0, 0}, 1}, {{0, 1}, 0}, {{1, 0}, 2}, {{1, 1}, 0}, {{2, 0}, 2}, {{2, 1}, 0}};
+    hx::DFA dfa(map, 0, {2});
+    dfa.compile(hx::DFA::flags::COMPRESS_STATE_TABLE);
+    ASSERT_EQ(dfa.getTransitionFunction().getType(), hx::TransitionType::TABLE);
+
+    std::string testStrings[] = {"100", "1001", "00"};
+    bool correct[] = {true, false, true};
+    performAutomataTest(dfa, testStrings, correct, 3, '0');
+}
+
+TEST(AutomataTest, ProfileGuidedLayout) {
+    // ring of 64 states, symbol 0 moves forward, symbol 1 jumps by 32
+    hx::DFA dfa(
+        [](std::size_t state, std::size_t action) -> std::size_t {
+            return (state + (action ? 32 : 1)) % 64;
+        },
+        0,
+        {33},
+        64,
+        2);
+    dfa.compile(hx::DFA::flags::CREATE_DYNAMIC_TABLE);
+
+    std::vector<std::size_t> sample = {1, 1, 1, 1, 0, 0};
+    ASSERT_EQ(dfa.getProfile(), nullptr);
+    ASSERT_EQ(dfa.profile(sample.begin(), sample.end()), 2);
+
+    const auto &histogram = dfa.getProfile()->getVisitHistogram();
+    ASSERT_EQ(histogram[0], 3);
+    ASSERT_EQ(histogram[32], 2);
+    ASSERT_EQ(histogram[1], 1);
+    ASSERT_EQ(histogram[2], 1);
+    ASSERT_EQ(std::accumulate(histogram.begin(), histogram.end(), 0ul), sample.size() + 1);
+
+    auto order = hx::DFAProfiledStateOrder(
+        const_cast<hx::TransitionFunction *>(&dfa.getTransitionFunction()),
+        64,
+        *dfa.getProfile());
+    ASSERT_EQ(order.size(), 64);
+    ASSERT_EQ(std::vector<std::size_t>(order.begin(), order.begin() + 5),
+              std::vector<std::size_t>({0, 32, 1, 2, 3}));
+
+    std::string testStrings[] = {"1", "01", "10", "0000000000000000000000000000000001"};
+    bool correct[] = {false, true, true, false};
+    performAutomataTest(dfa, testStrings, correct, 4, '0');
+
+    dfa.compile(hx::DFA::flags::REDUCE_STATE_TABLE | hx::DFA::flags::PROFILE_GUIDED_LAYOUT);
+    ASSERT_EQ(dfa.getTransitionFunction().getType(), hx::TransitionType::TABLE);
+    performAutomataTest(dfa, testStrings, correct, 4, '0');
+}
+
+TEST(AutomataTest, ProfileGuidedLayoutDropsUnreachableStates) {
+    // the ring of ProfileGuidedLayout followed by 64 states it never reaches
+    auto ring = [](std::size_t state, std::size_t action) -> std::size_t {
+        if (state >= 64) return 64 + (state + 1) % 64;
+        return (state + (action ? 32 : 1)) % 64;
+    };
+    hx::DFA reduced(ring, 0, {33}, 128, 2), kept(ring, 0, {33}, 128, 2);
+
+    std::vector<std::size_t> sample = {1, 1, 0, 0, 1};
+    reduced.profile(sample.begin(), sample.end());
+    kept.profile(sample.begin(), sample.end());
+
+    auto *function = const_cast<hx::TransitionFunction *>(&kept.getTransitionFunction());
+    auto accessible = hx::DFAAccessibleStates(function, 128, 2, 0);
+    ASSERT_EQ(hx::DFAProfiledStateOrder(function, 128, *kept.getProfile()).size(), 128u);
+    ASSERT_EQ(
+        hx::DFAProfiledStateOrder(function, 128, *kept.getProfile(), &accessible).size(),
+        64u);
+
+    reduced.compile(hx::DFA::flags::REDUCE_STATE_TABLE
+                    | hx::DFA::flags::PROFILE_GUIDED_LAYOUT);
+    kept.compile(hx::DFA::flags::PROFILE_GUIDED_LAYOUT);
+    ASSERT_LT(reduced.getTransitionFunction().memorySize(),
+              kept.getTransitionFunction().memorySize());
+
+    std::string testStrings[] = {"1", "01", "10", "0000000000000000000000000000000001"};
+    bool correct[] = {false, true, true, false};
+    performAutomataTest(reduced, testStrings, correct, 4, '0');
+}
+
+TEST(AutomataTest, RenumberedTables_ProcessMatchesGet) {
+    // 300 states, too many for a shuffle table, half of them sharing their futures
+    auto step = [](std::size_t state, std::size_t action) -> std::size_t {
+        return (state * 7 + action * 13 + 1) % 300 / 2 * 2 + state % 2;
+    };
+    std::default_random_engine randomness(97);
+    std::uniform_int_distribution<int> symbol(0, 3);
+    std::vector<std::size_t> sample(200);
+    for (auto &action : sample)
+        action = symbol(randomness);
+
+    std::uint8_t compileFlags[] = {
+        hx::DFA::flags::REDUCE_STATE_TABLE,
+        hx::DFA::flags::MINIMISE_STATE_TABLE,
+        hx::DFA::flags::REDUCE_STATE_TABLE | hx::DFA::flags::PROFILE_GUIDED_LAYOUT};
+    for (auto flags : compileFlags) {
+        hx::DFA dfa(step, 0, {5, 17}, 300, 4);
+        dfa.profile(sample.begin(), sample.end());
+        dfa.compile(flags);
+        const auto &function = dfa.getTransitionFunction();
+        ASSERT_EQ(function.getType(), hx::TransitionType::TABLE);
+
+        for (int i = 0; i < 200; ++i) {
+            std::vector<std::uint8_t> symbols(i % 50);
+            for (auto &action : symbols)
+                action = symbol(randomness);
+
+            // the reachable states as the compiled table names them
+            std::size_t state = dfa.getStartingState();
+            for (int j = i % 7; j > 0; --j)
+                state = function.get(state, symbol(randomness));
+
+            std::size_t expected = state;
+            for (auto action : symbols)
+                expected = function.get(expected, action);
+            const auto *data = symbols.data();
+            ASSERT_EQ(function.process(state, data, data + symbols.size()), expected)
+                << "flags " << int(flags) << ", sequence " << i;
+        }
+    }
+
+    // an undefined transition ends the run in the invalid state
+    hx::TransitionFunctionMap::ContainerMap map;
+    for (std::size_t state = 0; state < 20; ++state) {
+        map[{state, 0}] = (state + 1) % 20;
+        if (state % 2 == 0) map[{state, 1}] = state;
+    }
+    hx::DFA partial(map, 0, {3});
+    partial.compile(hx::DFA::flags::REDUCE_STATE_TABLE);
+    std::vector<std::uint8_t> symbols = {1, 0, 1, 0, 0};
+    const auto &function = partial.getTransitionFunction();
+    ASSERT_EQ(function.process(0, symbols.data(), symbols.data() + 2), 1u);
+    ASSERT_EQ(function.process(0, symbols.data(), symbols.data() + symbols.size()),
+              hx::DFA::INVALID_STATE);
+}
+
+TEST(AutomataTest, Minimisation_DuplicatedStates) {
+    // two copies of the "ends with 00" automata, crossing between each other
+    hx::TransitionFunctionMap::ContainerMap map = {{{0, 0}, 4},
+                                                   {{0, 1}, 3},
+                                                   {{1, 0}, 5},
+                                                   {{1, 1}, 0},
+                                                   {{2, 0}, 2},
+                                                   {{2, 1}, 3},
+                                                   {{3, 0}, 1},
+                                                   {{3, 1}, 0},
+                                                   {{4, 0}, 2},
+                                                   {{4, 1}, 3},
+                                                   {{5, 0}, 5},
+                                                   {{5, 1}, 0}};
+    hx::DFA dfa(map, 0, {2, 5});
+    std::string testStrings[] = {"11100101001110101110101001010100",
+                                 "10110101010100000010000010010101",
+                                 "1",
+                                 "0",
+                                 "00",
+                                 "11111111111111111111111111111100"};
+    bool correct[] = {true, false, false, false, true, true};
+
+    dfa.compile(hx::DFA::flags::MINIMISE_STATE_TABLE);
+    performAutomataTest(dfa, testStrings, correct, 6, '0');
+
+    auto accessible = hx::DFAAccessibleStates(
+        const_cast<hx::TransitionFunction *>(&dfa.getTransitionFunction()), 6, 2, 0);
+    ASSERT_EQ(std::accumulate(accessible.begin(), accessible.end(), 0), 3);
+
+    dfa.compile(hx::DFA::flags::REDUCE_STATE_TABLE);
+    ASSERT_EQ(dfa.getTransitionFunction().getType(), hx::TransitionType::SHUFFLE);
+    performAutomataTest(dfa, testStrings, correct, 6, '0');
+}
+
+TEST(AutomataTest, Minimisation_LargeRandomAutomata) {
+    // 25 copies of a random core automaton whose transitions hop between the copies,
+    // so the 100000 states minimise to what the core alone minimises to
+    constexpr std::size_t CORE = 4000, COPIES = 25, ACTIONS = 16;
+    constexpr std::size_t STATES = CORE * COPIES;
+    std::default_random_engine randomness(8642);
+    std::uniform_int_distribution<std::size_t> coreState(0, CORE - 1);
+    std::uniform_int_distribution<std::size_t> copy(0, COPIES - 1);
+
+    std::vector<std::size_t> core(CORE * ACTIONS), hops(STATES * ACTIONS);
+    for (auto &next : core)
+        next = coreState(randomness);
+    for (auto &next : hops)
+        next = copy(randomness);
+
+    std::vector<std::size_t> coreFinals, finals;
+    for (std::size_t state = 0; state < CORE; ++state) {
+        if (state % 3) continue;
+        coreFinals.push_back(state);
+        for (std::size_t c = 0; c < COPIES; ++c)
+            finals.push_back(c * CORE + state);
+    }
+
+    hx::DFA small(
+        [&](std::size_t state, std::size_t action) -> std::size_t {
+            return core[state * ACTIONS + action];
+        },
+        0,
+        coreFinals,
+        CORE,
+        ACTIONS);
+    auto step = [&](std::size_t state, std::size_t action) -> std::size_t {
+        return hops[state * ACTIONS + action] * CORE
+               + core[state % CORE * ACTIONS + action];
+    };
+    hx::DFA large(step, 0, finals, STATES, ACTIONS);
+    hx::DFA reference(step, 0, finals, STATES, ACTIONS);
+
+    small.compile(hx::DFA::flags::MINIMISE_STATE_TABLE);
+    large.compile(hx::DFA::flags::MINIMISE_STATE_TABLE);
+    auto classesOf = [](const hx::DFA &dfa) {
+        auto accessible = hx::DFAAccessibleStates(
+            const_cast<hx::TransitionFunction *>(&dfa.getTransitionFunction()),
+            dfa.getNumberOfStates(),
+            dfa.getNumberOfActions(),
+            dfa.getStartingState());
+        return std::accumulate(accessible.begin(), accessible.end(), std::size_t(0));
+    };
+    ASSERT_LE(classesOf(large), CORE);
+    ASSERT_EQ(classesOf(large), classesOf(small));
+
+    std::uniform_int_distribution<int> symbol(0, ACTIONS - 1);
+    for (int i = 0; i < 1000; ++i) {
+        std::vector<std::uint8_t> input(i % 40);
+        for (auto &action : input)
+            action = symbol(randomness);
+
+        reference.reset();
+        reference.process(input.begin(), input.end());
+        large.reset();
+        large.process(input.begin(), input.end());
+        ASSERT_EQ(large.isFinal(), reference.isFinal()) << "sequence " << i;
+    }
+}
+
+TEST(AutomataTest, Product_LazyAndEager) {
+    // alphabet {a, b, c}: whitelist contains "ab", blacklist ends with c
+    hx::TransitionFunctionMap::ContainerMap whitelistMap = {{{0, 0}, 1},
+                                                            {{0, 1}, 0},
+                                                            {{0, 2}, 0},
+                                                            {{1, 0}, 1},
+                                                            {{1, 1}, 2},
+                                                            {{1, 2}, 0},
+                                                            {{2, 0}, 2},
+                                                            {{2, 1}, 2},
+                                                            {{2, 2}, 2}};
+    hx::TransitionFunctionMap::ContainerMap blacklistMap = {{{0, 0}, 0},
+                                                            {{0, 1}, 0},
+                                                            {{0, 2}, 1},
+                                                            {{1, 0}, 0},
+                                                            {{1, 1}, 0},
+                                                            {{1, 2}, 1}};
+    hx::DFA whitelist(whitelistMap, 0, {2});
+    hx::DFA blacklist(blacklistMap, 0, {1});
+
+    std::default_random_engine randomness(1357);
+    std::uniform_int_distribution<std::size_t> symbol(0, 2);
+    std::vector<std::vector<std::size_t>> inputs(200);
+    for (auto &input : inputs) {
+        for (std::size_t i = symbol(randomness) * 4; i > 0; --i)
+            input.push_back(symbol(randomness));
+    }
+
+    for (auto type : {hx::DFAProductType::INTERSECTION,
+                      hx::DFAProductType::UNION,
+                      hx::DFAProductType::DIFFERENCE}) {
+        auto product = hx::DFA::product(whitelist, blacklist, type);
+        ASSERT_LE(product.getNumberOfStates(), 6u);
+
+        hx::DFAProductCursor lazy(whitelist, blacklist, type);
+        for (const auto &input : inputs) {
+            auto a = whitelist.cursor(), b = blacklist.cursor();
+            a.process(input.begin(), input.end());
+            b.process(input.begin(), input.end());
+            bool expected = hx::DFAProductAccepts(type, a.isFinal(), b.isFinal());
+
+            lazy.reset();
+            lazy.process(input.begin(), input.end());
+            ASSERT_EQ(lazy.isFinal(), expected);
+
+            product.reset();
+            product.process(input.begin(), input.end());
+            ASSERT_EQ(product.isFinal(), expected);
+        }
+
+        product.compile(hx::DFA::flags::MINIMISE_STATE_TABLE
+                        | hx::DFA::flags::REDUCE_STATE_TABLE);
+        for (const auto &input : inputs) {
+            auto a = whitelist.cursor(), b = blacklist.cursor();
+            a.process(input.begin(), input.end());
+            b.process(input.begin(), input.end());
+
+            product.reset();
+            product.process(input.begin(), input.end());
+            ASSERT_EQ(product.isFinal(),
+                      hx::DFAProductAccepts(type, a.isFinal(), b.isFinal()));
+        }
+    }
+
+    ASSERT_THROW(hx::DFA::product(whitelist, blacklist, hx::DFAProductType::UNION, 2),
+                 std::length_error);
+}
+
+TEST(AutomataTest, Product_PartialOperands) {
+    // "0+" over an alphabet of one symbol and "0*1+" over {0, 1}, both partial
+    hx::TransitionFunctionMap::ContainerMap zerosMap = {{{0, 0}, 1}, {{1, 0}, 1}};
+    hx::TransitionFunctionMap::ContainerMap onesMap = {
+        {{0, 0}, 0}, {{0, 1}, 1}, {{1, 1}, 1}};
+    hx::DFA zeros(zerosMap, 0, {1});
+    hx::DFA ones(onesMap, 0, {1});
+
+    for (auto type : {hx::DFAProductType::INTERSECTION,
+                      hx::DFAProductType::UNION,
+                      hx::DFAProductType::DIFFERENCE}) {
+        auto product = hx::DFA::product(zeros, ones, type);
+
+        // every sequence up to six symbols, most of them run past a dead side
+        for (std::size_t length = 0; length <= 6; ++length) {
+            for (std::size_t bits = 0; bits < (std::size_t(1) << length); ++bits) {
+                std::vector<std::size_t> input;
+                for (std::size_t i = 0; i < length; ++i)
+                    input.push_back((bits >> i) & 1);
+
+                hx::DFAProductCursor lazy(zeros, ones, type);
+                lazy.process(input.begin(), input.end());
+                product.reset();
+                product.process(input.begin(), input.end());
+                ASSERT_EQ(product.isFinal(), lazy.isFinal());
+            }
+        }
+    }
 }
\ No newline at end of file
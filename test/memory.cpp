@@ -1,10 +1,51 @@
 #include <gtest/gtest.h>
 
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
 #include <stdexcept>
+#include <utility>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "core/DeviceCPU.hpp"
+#include "memory/AllocationTracker.hpp"
+#include "memory/EigenMap.hpp"
+#include "memory/Kernels.hpp"
+#include "memory/LinearAlgebra.hpp"
+#include "memory/MappedStorage.hpp"
+#include "memory/NumaStorage.hpp"
+#include "memory/Resource.hpp"
+#include "memory/SharedMemoryStorage.hpp"
+#include "memory/StaticView.hpp"
 #include "memory/Storage.hpp"
 #include "memory/StorageView.hpp"
 
+namespace {
+class CountingResource : public std::pmr::memory_resource {
+public:
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+        ++deallocations;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+}// namespace
+
 TEST(MemoryTest, CreateCustomView) {
     hx::memory::Storage storage(1024 * 1024);
     auto *ptr = storage.get_as<float>();
@@ -22,4 +63,547 @@ TEST(MemoryTest, CreateCustomView) {
     ASSERT_EQ(y(0), view(1, 1, 2, 0));
     ASSERT_EQ(y(2), view(1, 1, 2, 2));
     ASSERT_EQ(y(3), view(1, 1, 2, 3));
+}
+
+TEST(MemoryTest, StorageFromMonotonicResource) {
+    CountingResource upstream;
+    {
+        hx::memory::MonotonicResource arena(4096, &upstream);
+        for (std::size_t i = 0; i < 16; ++i) {
+            hx::memory::Storage storage(128, &arena, 64);
+            ASSERT_EQ(reinterpret_cast<std::uintptr_t>(storage.get()) % 64, 0u);
+            ASSERT_EQ(storage.resource(), &arena);
+        }
+        ASSERT_EQ(upstream.allocations, 1u);
+        ASSERT_EQ(upstream.deallocations, 0u);
+
+        arena.release();
+        ASSERT_EQ(upstream.deallocations, 1u);
+    }
+}
+
+TEST(MemoryTest, StorageFromPoolResourceIsRecycled) {
+    CountingResource upstream;
+    hx::memory::UnsynchronizedPoolResource pool(&upstream);
+
+    { hx::memory::Storage warmup(256, &pool, 32); }
+    auto allocations = upstream.allocations;
+
+    for (std::size_t i = 0; i < 1000; ++i) {
+        hx::memory::Storage storage(256, &pool, 32);
+        storage.get_as<float>()[0] = i;
+    }
+    ASSERT_EQ(upstream.allocations, allocations);
+}
+
+TEST(MemoryTest, StorageCopyAndMoveKeepResource) {
+    hx::memory::UnsynchronizedPoolResource pool;
+    hx::memory::Storage storage(64, &pool, 32);
+    for (std::size_t i = 0; i < storage.size_as<float>(); ++i)
+        storage.get_as<float>()[i] = i;
+
+    auto copy = storage.copy();
+    ASSERT_EQ(copy.resource(), &pool);
+    ASSERT_EQ(copy.alignment(), 32u);
+    ASSERT_NE(copy.get(), storage.get());
+    ASSERT_EQ(copy.get_as<float>()[15], 15.0f);
+
+    hx::memory::Storage moved(std::move(copy));
+    copy = hx::memory::Storage(16);
+    ASSERT_EQ(moved.resource(), &pool);
+    ASSERT_EQ(moved.get_as<float>()[15], 15.0f);
+    ASSERT_EQ(copy.resource(), nullptr);
+}
+
+TEST(MemoryTest, SharedStorageCopiesOnWrite) {
+    hx::memory::Storage storage(64 * sizeof(float));
+    for (std::size_t i = 0; i < 64; ++i)
+        storage.get_as<float>()[i] = i;
+
+    const auto shared = storage.share();
+    ASSERT_TRUE(storage.isShared());
+    ASSERT_EQ(shared.get_as<float>(), std::as_const(storage).get_as<float>());
+
+    auto second = shared.share();
+    ASSERT_EQ(std::as_const(second).get_as<float>(), shared.get_as<float>());
+
+    // a write detaches only the written storage
+    second.get_as<float>()[0] = -1.0f;
+    ASSERT_NE(std::as_const(second).get_as<float>(), shared.get_as<float>());
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(second.get()) % 64, 0u);
+    ASSERT_FALSE(second.isShared());
+    ASSERT_EQ(shared.get_as<float>()[0], 0.0f);
+    ASSERT_EQ(std::as_const(second).get_as<float>()[63], 63.0f);
+
+    hx::memory::StorageView<float, 2> view(&storage, 8, 8);
+    view(0, 1) = -2.0f;
+    ASSERT_FALSE(storage.isShared());
+    ASSERT_FALSE(shared.isShared());
+    ASSERT_EQ(shared.get_as<float>()[1], 1.0f);
+}
+
+TEST(MemoryTest, StorageViewBlocksShare) {
+    hx::memory::Storage storage(16 * sizeof(float));
+    {
+        hx::memory::StorageView<float, 2> view(&storage, 4, 4);
+        view(0, 0) = 1.0f;
+
+        // the view would keep writing into the buffer the copy sees
+        ASSERT_THROW(storage.share(), std::logic_error);
+        auto copy = view;
+        ASSERT_THROW(storage.share(), std::logic_error);
+        hx::memory::StorageView<const float, 2> reader(&storage, 4, 4);
+        ASSERT_EQ(reader(0, 0), 1.0f);
+    }
+
+    const auto snapshot = storage.share();
+    hx::memory::StorageView<const float, 2> reader(&storage, 4, 4);
+    ASSERT_EQ(reader.data(), snapshot.get_as<float>());
+    ASSERT_NO_THROW(storage.share());
+
+    // a view built over a shared storage detaches it first
+    hx::memory::StorageView<float, 2> view(&storage, 4, 4);
+    view(0, 0) = 2.0f;
+    ASSERT_NE(view.data(), snapshot.get_as<float>());
+    ASSERT_EQ(snapshot.get_as<float>()[0], 1.0f);
+    ASSERT_FALSE(storage.isShared());
+}
+
+TEST(MemoryTest, SharedStorageDetachesIntoResource) {
+    CountingResource upstream;
+    hx::memory::Storage storage(256, &upstream, 32);
+    {
+        auto shared = storage.share();
+        ASSERT_EQ(shared.resource(), &upstream);
+        ASSERT_EQ(upstream.allocations, 1u);
+
+        shared.get_as<float>()[0] = 1.0f;
+        ASSERT_EQ(upstream.allocations, 2u);
+        ASSERT_EQ(shared.alignment(), 32u);
+    }
+    ASSERT_EQ(upstream.deallocations, 1u);
+
+    // the last owner of a shared buffer writes in place
+    {
+        auto shared = storage.share();
+        storage = hx::memory::Storage(16);
+        shared.get_as<float>()[0] = 1.0f;
+        ASSERT_EQ(upstream.allocations, 2u);
+    }
+    ASSERT_EQ(upstream.deallocations, 2u);
+}
+
+TEST(MemoryTest, AnonymousMappings) {
+    for (auto mode : {hx::memory::PageMode::SMALL,
+                      hx::memory::PageMode::TRANSPARENT_HUGE,
+                      hx::memory::PageMode::EXPLICIT_HUGE}) {
+        auto storage = hx::memory::mapAnonymous(3 << 20, mode);
+        ASSERT_EQ(storage.size(), std::size_t(3) << 20);
+        ASSERT_EQ(reinterpret_cast<std::uintptr_t>(storage.get()) % 4096, 0u);
+
+        auto *data = storage.get_as<std::uint32_t>();
+        ASSERT_EQ(data[storage.size_as<std::uint32_t>() - 1], 0u);
+        for (std::size_t i = 0; i < storage.size_as<std::uint32_t>(); ++i)
+            data[i] = i;
+        ASSERT_EQ(data[12345], 12345u);
+    }
+
+    // small buffers stay on the heap, large ones start on a huge page boundary
+    hx::DeviceCPU device;
+    auto small = device.getStorage(1024, true);
+    auto large = device.getStorage(8 << 20);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(small.get()) % 32, 0u);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(large.get()) % (2 << 20), 0u);
+}
+
+TEST(MemoryTest, FileMappings) {
+    std::string path = ::testing::TempDir() + "hx_memory_file_mapping";
+    std::remove(path.c_str());
+    {
+        auto storage =
+            hx::memory::mapFile(path, hx::memory::MappingAccess::READ_WRITE, 4096);
+        ASSERT_EQ(storage.size(), 4096u);
+        for (std::size_t i = 0; i < storage.size_as<std::uint32_t>(); ++i)
+            storage.get_as<std::uint32_t>()[i] = 3 * i;
+    }
+
+    {
+        const auto storage = hx::memory::mapFile(path);
+        ASSERT_EQ(storage.size(), 4096u);
+        ASSERT_EQ(storage.get_as<std::uint32_t>()[1000], 3000u);
+    }
+
+    ASSERT_THROW(hx::memory::mapFile(path, hx::memory::MappingAccess::READ_ONLY, 8192),
+                 std::system_error);
+    std::remove(path.c_str());
+    ASSERT_THROW(hx::memory::mapFile(path), std::system_error);
+}
+
+TEST(MemoryTest, NumaPolicies) {
+    ASSERT_GE(hx::memory::numaNodes(), 1u);
+
+    for (auto policy : {hx::memory::NumaPolicy::LOCAL,
+                        hx::memory::NumaPolicy::INTERLEAVED,
+                        hx::memory::NumaPolicy::BIND}) {
+        auto storage = hx::memory::mapNuma(1 << 20, policy);
+        auto *data = storage.get_as<float>();
+        for (std::size_t i = 0; i < storage.size_as<float>(); ++i)
+            data[i] = i;
+        ASSERT_EQ(data[1000], 1000.0f);
+    }
+
+    ASSERT_THROW(hx::memory::mapNuma(4096,
+                                     hx::memory::NumaPolicy::BIND,
+                                     hx::memory::numaNodes()),
+                 std::out_of_range);
+}
+
+TEST(MemoryTest, ParallelFirstTouch) {
+    hx::ThreadPool<> pool(4);
+    auto storage = hx::memory::mapNuma(1000003 * sizeof(std::uint32_t),
+                                       hx::memory::NumaPolicy::LOCAL);
+
+    hx::memory::parallelFirstTouch<std::uint32_t>(
+        storage, pool, [](std::size_t offset, std::uint32_t *begin, std::uint32_t *end) {
+            for (; begin != end; ++begin, ++offset)
+                *begin = offset;
+        });
+
+    const auto *data = std::as_const(storage).get_as<std::uint32_t>();
+    for (std::size_t i = 0; i < storage.size_as<std::uint32_t>(); ++i)
+        ASSERT_EQ(data[i], i);
+}
+
+TEST(MemoryTest, SharedMemoryAcrossProcesses) {
+    std::string name = "/hx_memory_test_" + std::to_string(getpid());
+    hx::memory::unlinkSharedMemory(name);
+
+    auto created =
+        hx::memory::mapSharedMemory(name, hx::memory::SharedMemoryMode::CREATE, 4096);
+    created.get_as<std::uint32_t>()[0] = 7;
+    ASSERT_THROW(
+        hx::memory::mapSharedMemory(name, hx::memory::SharedMemoryMode::CREATE, 4096),
+        std::system_error);
+
+    // the child writes through its own mapping of the same segment
+    pid_t child = fork();
+    if (child == 0) {
+        auto attached =
+            hx::memory::mapSharedMemory(name, hx::memory::SharedMemoryMode::ATTACH);
+        attached.get_as<std::uint32_t>()[1] = attached.get_as<std::uint32_t>()[0] + 1;
+        _exit(attached.size() == 4096 ? 0 : 1);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+
+    const auto readOnly =
+        hx::memory::mapSharedMemory(name, hx::memory::SharedMemoryMode::READ_ONLY);
+    ASSERT_EQ(readOnly.get_as<std::uint32_t>()[1], 8u);
+    ASSERT_EQ(std::as_const(created).get_as<std::uint32_t>()[1], 8u);
+
+    hx::memory::unlinkSharedMemory(name);
+    ASSERT_THROW(hx::memory::mapSharedMemory(name, hx::memory::SharedMemoryMode::ATTACH),
+                 std::system_error);
+}
+
+TEST(MemoryTest, MemoryFileMappings) {
+    int fd = hx::memory::createMemoryFile("hx_memory_test", 8192);
+    {
+        auto writable =
+            hx::memory::mapFileDescriptor(fd, hx::memory::MappingAccess::READ_WRITE);
+        ASSERT_EQ(writable.size(), 8192u);
+        writable.get_as<float>()[2047] = 1.5f;
+    }
+
+    const auto readOnly = hx::memory::mapFile("/proc/self/fd/" + std::to_string(fd));
+    close(fd);
+    ASSERT_EQ(readOnly.get_as<float>()[2047], 1.5f);
+}
+
+namespace {
+constexpr float staticViewSum() {
+    float data[6] = {1, 2, 3, 4, 5, 6};
+    hx::memory::StaticView<float, hx::memory::Extents<2, 3>> view(data);
+
+    float sum = 0;
+    for (std::size_t i = 0; i < view.extent<0>(); ++i)
+        sum += view(i, 2);
+    return sum;
+}
+}// namespace
+
+TEST(MemoryTest, StaticViewLayouts) {
+    using hx::memory::DYNAMIC_EXTENT;
+    static_assert(staticViewSum() == 9.0f);
+
+    float data[64];
+    for (std::size_t i = 0; i < 64; ++i)
+        data[i] = i;
+
+    hx::memory::StaticView<float, hx::memory::Extents<DYNAMIC_EXTENT, 3, 4>> right(
+        data, 2);
+    static_assert(decltype(right)::ExtentsType::RANK_DYNAMIC == 1);
+    ASSERT_EQ(right.stride<0>(), 12u);
+    ASSERT_EQ(right.size(), 24u);
+    ASSERT_EQ(right(1, 2, 3), 23.0f);
+
+    hx::memory::StaticView<float, hx::memory::Extents<2, 3, 4>, hx::memory::LayoutLeft>
+        left(data);
+    ASSERT_EQ(left.stride<2>(), 6u);
+    ASSERT_EQ(left(1, 0, 0), 1.0f);
+    ASSERT_EQ(left(1, 2, 3), 1.0f + 2 * 2 + 3 * 6);
+
+    // rows padded like the rule and control point storages
+    hx::memory::StaticView<const float,
+                           hx::memory::Extents<DYNAMIC_EXTENT, DYNAMIC_EXTENT>,
+                           hx::memory::LayoutPadded<8>>
+        padded(data, 3, 5);
+    ASSERT_EQ(padded.stride<0>(), 8u);
+    ASSERT_EQ(padded.size(), 15u);
+    ASSERT_EQ(padded.span(), 21u);
+    ASSERT_EQ(padded(2, 4), 20.0f);
+
+    hx::memory::Storage storage(64 * sizeof(float));
+    hx::memory::StaticView<float, hx::memory::Extents<8, 8>> fromStorage(&storage);
+    fromStorage(7, 7) = 1.0f;
+    ASSERT_EQ(std::as_const(storage).get_as<float>()[63], 1.0f);
+}
+
+TEST(MemoryTest, KernelsOnDenseAndPaddedViews) {
+    hx::DeviceCPU device;
+    auto storage = device.getStorage(1003 * 8 * sizeof(float), true);
+    auto *data = storage.get_as<float>();
+
+    // rows of 7 values padded to 8, like the rule storages, plus a dense view of all
+    hx::memory::View<float, 2> padded(data, {8, 1}, {1003, 7});
+    hx::memory::View<float, 1> dense(data, 1003 * 8);
+
+    hx::memory::fill(dense, -1.0f);
+    hx::memory::fill(padded, 2.0f);
+    ASSERT_EQ(hx::memory::count(dense, hx::memory::Comparison::EQUAL, -1.0f), 1003u);
+    ASSERT_EQ(hx::memory::sum(padded), 2.0f * 1003 * 7);
+
+    std::vector<float> values(1003 * 7);
+    for (std::size_t i = 0; i < values.size(); ++i)
+        values[i] = std::sin(static_cast<float>(i));
+    hx::memory::View<float, 2> source(values.data(), 1003, 7);
+    hx::memory::copy(source, padded);
+    ASSERT_EQ(padded(1000, 6), values[1000 * 7 + 6]);
+    ASSERT_EQ(data[1000 * 8 + 7], -1.0f);
+
+    float expectedSum = 0, expectedMin = 2, expectedMax = -2;
+    std::size_t expectedCount = 0;
+    for (auto value : values) {
+        expectedSum += value;
+        expectedMin = std::min(expectedMin, value);
+        expectedMax = std::max(expectedMax, value);
+        expectedCount += value > 0.5f;
+    }
+    ASSERT_NEAR(hx::memory::sum(padded), expectedSum, 1e-2);
+    ASSERT_EQ(hx::memory::min(padded), expectedMin);
+    ASSERT_EQ(hx::memory::max(padded), expectedMax);
+    ASSERT_EQ(hx::memory::count(padded, hx::memory::Comparison::GREATER, 0.5f),
+              expectedCount);
+
+    // offset by one float, so the vector loops start unaligned
+    hx::memory::View<float, 1> x(values.data() + 1, 999), y(data + 1, 999);
+    hx::memory::fill(y, 1.0f);
+    hx::memory::axpy(2.0f, x, y);
+    ASSERT_FLOAT_EQ(data[500], 1.0f + 2.0f * values[500]);
+
+    std::vector<std::uint8_t> flags(1003 * 7);
+    hx::memory::View<std::uint8_t, 2> flagsView(flags.data(), 1003, 7);
+    hx::memory::compare(source, hx::memory::Comparison::GREATER, 0.5f, flagsView);
+    ASSERT_EQ(std::size_t(std::count(flags.begin(), flags.end(), 1)), expectedCount);
+
+    // the dispatcher picks the widest set, run the narrower one explicitly as well
+    if (hx::memory::kernelIsa() != hx::memory::KernelIsa::SCALAR) {
+        using hx::memory::__internal::ReduceOp;
+        const auto *row = values.data() + 3;
+        const std::size_t size = values.size() - 3;
+        ASSERT_NEAR(hx::memory::__internal::reduceAVX2<ReduceOp::SUM>(row, size, 0.0f),
+                    expectedSum - values[0] - values[1] - values[2],
+                    1e-2);
+        ASSERT_EQ(hx::memory::__internal::reduceAVX2<ReduceOp::MAX>(row, size, -2.0f),
+                  expectedMax);
+
+        std::size_t processed;
+        auto counted = hx::memory::__internal::countAVX2<_CMP_GT_OQ>(
+            values.data(), values.size(), 0.5f, processed);
+        for (; processed < values.size(); ++processed)
+            counted += values[processed] > 0.5f;
+        ASSERT_EQ(counted, expectedCount);
+    }
+}
+
+TEST(MemoryTest, KernelsGenericAndParallel) {
+    std::vector<double> values(4096);
+    hx::memory::View<double, 3> view(values.data(), 16, 16, 16);
+
+    hx::ThreadPool<> pool(4);
+    hx::memory::fill(view, 0.5, pool);
+    ASSERT_EQ(hx::memory::sum(view, pool), 2048.0);
+
+    std::vector<double> doubled(4096);
+    hx::memory::View<double, 3> doubledView(doubled.data(), 16, 16, 16);
+    hx::memory::transform(view, doubledView, [](double value) { return value * 2; });
+    hx::memory::axpy(3.0, doubledView, view, pool);
+    ASSERT_EQ(hx::memory::min(view), 3.5);
+    ASSERT_EQ(hx::memory::max(doubledView), 1.0);
+
+    std::vector<float> empty;
+    hx::memory::View<float, 1> emptyView(empty.data(), 0);
+    ASSERT_EQ(hx::memory::sum(emptyView), 0.0f);
+    ASSERT_EQ(hx::memory::min(emptyView), std::numeric_limits<float>::max());
+}
+
+TEST(MemoryTest, EigenMapsOfPaddedViews) {
+    // 3x5 matrix in rows padded to 8 floats, the padding holds a sentinel
+    hx::memory::Storage storage(3 * 8 * sizeof(float));
+    hx::memory::StorageView<float, 2> matrix(&storage, {8, 1}, {3, 5});
+    std::fill(storage.get_as<float>(), storage.get_as<float>() + 24, -1.0f);
+    for (std::size_t i = 0; i < 3; ++i)
+        for (std::size_t j = 0; j < 5; ++j)
+            matrix(i, j) = i * 10 + j;
+
+    auto map = hx::memory::asEigen(matrix);
+    ASSERT_EQ(map.rows(), 3);
+    ASSERT_EQ(map.cols(), 5);
+    ASSERT_EQ(map(2, 4), 24.0f);
+    ASSERT_EQ(map.sum(), 10.0f * 15 + 3 * 10);
+
+    map.col(1).setConstant(7.0f);
+    ASSERT_EQ(matrix(0, 1), 7.0f);
+    ASSERT_EQ(storage.get_as<float>()[5], -1.0f);
+
+    // transposed through the strides
+    hx::memory::View<float, 2> transposed(storage.get_as<float>(), {1, 8}, {5, 3});
+    const auto &constTransposed = transposed;
+    ASSERT_EQ(hx::memory::asEigen(constTransposed), map.transpose());
+
+    auto column = matrix[0];
+    hx::memory::View<float, 1> strided(storage.get_as<float>() + 2, {8}, {3});
+    ASSERT_EQ(hx::memory::asEigen(column).size(), 5);
+    ASSERT_EQ(hx::memory::asEigen(strided), map.col(2));
+}
+
+TEST(MemoryTest, LinearAlgebraKernels) {
+    hx::memory::RowMajorMatrix<float> a(4, 3), b(3, 6);
+    a.setRandom();
+    b.setRandom();
+
+    hx::memory::View<float, 2> aView(a.data(), 4, 3);
+    hx::memory::View<float, 2> bView(b.data(), 3, 6);
+
+    // C lives in padded rows
+    std::vector<float> c(4 * 8, 1.0f);
+    hx::memory::View<float, 2> cView(c.data(), {8, 1}, {4, 6});
+    hx::memory::gemm(2.0f, aView, bView, 0.5f, cView);
+
+    hx::memory::RowMajorMatrix<float> expected =
+        2.0f * a * b + 0.5f * hx::memory::RowMajorMatrix<float>::Ones(4, 6);
+    ASSERT_TRUE(hx::memory::asEigen(cView).isApprox(expected));
+    ASSERT_EQ(c[6], 1.0f);
+
+    ASSERT_THROW(hx::memory::gemm(1.0f, bView, bView, 0.0f, cView), std::invalid_argument);
+
+    std::vector<float> values(64);
+    hx::memory::View<float, 1> valuesView(values.data(), 64);
+    hx::memory::View<float, 1> everyOther(values.data(), {2}, {32});
+
+    hx::memory::RandomStream random(42);
+    random.uniform(valuesView, 1.0f, 2.0f);
+    ASSERT_GE(hx::memory::min(valuesView), 1.0f);
+    ASSERT_LT(hx::memory::max(valuesView), 2.0f);
+
+    auto original = values;
+    hx::memory::log(everyOther, everyOther);
+    hx::memory::exp(everyOther, everyOther);
+    hx::memory::sqrt(valuesView, valuesView);
+    for (std::size_t i = 0; i < values.size(); ++i)
+        ASSERT_NEAR(values[i], std::sqrt(original[i]), 1e-5f);
+
+    std::vector<float> gaussian(4096);
+    hx::memory::View<float, 2> gaussianView(gaussian.data(), 64, 64);
+    random.gaussian(gaussianView, 3.0f, 0.5f);
+    ASSERT_NEAR(hx::memory::sum(gaussianView) / gaussian.size(), 3.0f, 0.05f);
+}
+
+TEST(MemoryTest, AllocationTrackingPerTag) {
+    hx::DeviceCPU device;
+    auto &tracker = device.getAllocationTracker();
+    {
+        auto population = device.getStorage(4096, hx::StorageHint::FAST, "population");
+        auto points = device.getStorage(8 << 20, hx::StorageHint::NONE, "points");
+        auto untagged = device.getStorage(100);
+
+        auto snapshot = tracker.snapshot();
+        ASSERT_EQ(snapshot["population"].liveBytes, 4096u);
+        ASSERT_EQ(snapshot["points"].liveBytes, std::size_t(8 << 20));
+        ASSERT_EQ(snapshot[hx::memory::AllocationTracker::UNTAGGED].allocations, 1u);
+        ASSERT_EQ(tracker.total().liveBytes, 4096u + (8 << 20) + 100);
+
+        // sharing does not allocate, writing to a shared buffer does
+        auto shared = population.share();
+        ASSERT_EQ(tracker.snapshot()["population"].allocations, 1u);
+        shared.get_as<float>()[0] = 1.0f;
+        ASSERT_EQ(tracker.snapshot()["population"].liveBytes, 8192u);
+
+        auto copy = untagged.copy();
+        ASSERT_EQ(copy.counters(), untagged.counters());
+        ASSERT_EQ(tracker.total().peakBytes, 2 * 4096u + (8 << 20) + 200);
+    }
+
+    auto total = tracker.total();
+    ASSERT_EQ(total.liveBytes, 0u);
+    ASSERT_EQ(total.liveAllocations(), 0u);
+    ASSERT_EQ(total.allocations, 5u);
+
+    std::ostringstream report;
+    tracker.report(report, true);
+    ASSERT_EQ(report.str().find("population"), std::string::npos);
+    ASSERT_NE(report.str().find("total"), std::string::npos);
+
+    hx::memory::AllocationTracker pooled;
+    hx::memory::TrackingResource upstream(pooled.counters("pool"));
+    {
+        hx::memory::UnsynchronizedPoolResource pool(&upstream);
+        for (int i = 0; i < 64; ++i)
+            hx::memory::Storage(256, &pool).track(pooled.counters("boxes"));
+
+        auto snapshot = pooled.snapshot();
+        ASSERT_EQ(snapshot["boxes"].allocations, 64u);
+        ASSERT_EQ(snapshot["boxes"].peakBytes, 256u);
+        ASSERT_LT(snapshot["pool"].allocations, 64u);
+    }
+    ASSERT_EQ(pooled.snapshot()["pool"].liveBytes, 0u);
+}
+
+TEST(MemoryTest, TrackingSharedStorage) {
+    hx::memory::AllocationTracker tracker;
+    auto &counters = tracker.counters("shared");
+
+    hx::memory::Storage storage(16 * sizeof(float));
+    storage.get_as<float>()[0] = 1.0f;
+    {
+        auto shared = storage.share();
+        shared.track(counters);
+        ASSERT_TRUE(shared.isShared());
+        ASSERT_EQ(storage.counters(), &counters);
+        ASSERT_EQ(counters.statistics().liveBytes, 16 * sizeof(float));
+
+        // writing through the tracked owner still detaches it
+        shared.get_as<float>()[0] = 2.0f;
+        ASSERT_EQ(std::as_const(storage).get_as<float>()[0], 1.0f);
+        ASSERT_EQ(shared.counters(), &counters);
+        ASSERT_EQ(counters.statistics().liveBytes, 2 * 16 * sizeof(float));
+    }
+
+    // the shared buffer is released, and uncounted, with its last owner
+    ASSERT_EQ(counters.statistics().liveBytes, 16 * sizeof(float));
+    storage = hx::memory::Storage(4);
+    ASSERT_EQ(counters.statistics().liveBytes, 0u);
+    ASSERT_EQ(counters.statistics().liveAllocations(), 0u);
 }
\ No newline at end of file
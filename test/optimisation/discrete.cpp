@@ -1,9 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <cstdlib>
 #include <iostream>
+#include <random>
 #include <stdexcept>
 #include "optimisation/discrete/GeneticAlgorithm.hpp"
 #include "optimisation/discrete/OptimisationSolution.hpp"
+#include "optimisation/discrete/ParallelTempering.hpp"
 #include "optimisation/discrete/SimulatedAnnealing.hpp"
 
 auto testData = std::vector<std::size_t>{
@@ -88,4 +91,150 @@ TEST(OptimisationDiscrete, TestSimulatedAnnealing) {
         auto a = annealing.fitEpoch();
         ASSERT_EQ(a, partial[i]);
     }
+}
+
+// random walk over the integers, scored by the distance to 37
+class WalkSolution : public hx::optimisation::discrete::OptimisationSolution<std::size_t> {
+public:
+    WalkSolution(long position, std::default_random_engine &entropy)
+        : position(position), randomness(&entropy) {}
+
+    void setRandomEngine(std::default_random_engine &entropy) { randomness = &entropy; }
+
+    long position;
+    // proposals only ever move away from the start
+    static bool uphillOnly;
+    static long farthestProposal;
+
+private:
+    std::size_t scoreSolution() const override { return std::labs(position - 37); }
+    void neighbouring_() override {
+        position += uphillOnly || std::bernoulli_distribution()(*randomness) ? 1 : -1;
+        if (uphillOnly) farthestProposal = std::max(farthestProposal, position);
+    }
+
+    std::default_random_engine *randomness;
+};
+
+bool WalkSolution::uphillOnly = false;
+long WalkSolution::farthestProposal = 0;
+
+TEST(OptimisationDiscrete, TestSimulatedAnnealingRejectsUphillWhenCold) {
+    std::default_random_engine entropy(7);
+    WalkSolution::uphillOnly = true;
+    WalkSolution::farthestProposal = 0;
+
+    hx::optimisation::discrete::SimulatedAnnealing<WalkSolution> annealing(
+        WalkSolution(37, entropy), 1e-6, 1.0, 100);
+    annealing.fitEpoch();
+    WalkSolution::uphillOnly = false;
+
+    // every proposal starts from the optimum, none of them is accepted
+    ASSERT_EQ(WalkSolution::farthestProposal, 38);
+}
+
+TEST(OptimisationDiscrete, TestParallelTempering) {
+    std::default_random_engine entropy(7);
+    ASSERT_THROW(hx::optimisation::discrete::ParallelTempering<WalkSolution>(
+                     WalkSolution(0, entropy), 4, 2.0, 1.0),
+                 std::invalid_argument);
+
+    hx::optimisation::discrete::ParallelTempering<WalkSolution> tempering(
+        WalkSolution(-500, entropy), 8, 0.5, 64.0, 50);
+    ASSERT_EQ(tempering.replicas(), 8u);
+    ASSERT_DOUBLE_EQ(tempering.temperature(0), 0.5);
+    ASSERT_DOUBLE_EQ(tempering.temperature(7), 64.0);
+    ASSERT_DOUBLE_EQ(tempering.temperature(4) / tempering.temperature(3), 2.0);
+
+    std::size_t best = 537;
+    for (std::size_t epoch = 0; epoch < 400; ++epoch) {
+        auto score = tempering.fitEpoch();
+        ASSERT_LE(score, best);
+        best = score;
+    }
+    ASSERT_EQ(best, 0u);
+    ASSERT_EQ(tempering.getBest().position, 37);
+    ASSERT_GT(tempering.exchangeRate(0), 0.0);
+}
+
+// WalkSolution moving in place, counting the copies made of it
+class UndoWalkSolution
+    : public hx::optimisation::discrete::OptimisationSolution<std::size_t> {
+public:
+    UndoWalkSolution(long position, std::default_random_engine &entropy)
+        : position(position), randomness(&entropy) {}
+    UndoWalkSolution(const UndoWalkSolution &rhs)
+        : OptimisationSolution(rhs)
+        , position(rhs.position)
+        , randomness(rhs.randomness) {
+        ++copies;
+    }
+    UndoWalkSolution &operator=(const UndoWalkSolution &rhs) {
+        OptimisationSolution::operator=(rhs);
+        position = rhs.position;
+        ++copies;
+        return *this;
+    }
+
+    bool supportsUndo() const noexcept override { return true; }
+
+    long position;
+    static std::size_t copies;
+
+private:
+    std::size_t scoreSolution() const override { return std::labs(position - 37); }
+    void neighbouring_() override {
+        step = std::bernoulli_distribution()(*randomness) ? 1 : -1;
+        position += step;
+    }
+    void undoNeighbouring_() override { position -= step; }
+
+    std::default_random_engine *randomness;
+    long step = 0;
+};
+
+std::size_t UndoWalkSolution::copies = 0;
+
+TEST(OptimisationDiscrete, TestProposalsUndo) {
+    std::default_random_engine entropy(3);
+    UndoWalkSolution walk(30, entropy);
+    ASSERT_EQ(walk.getScore(), 7u);
+
+    for (int i = 0; i < 100; ++i) {
+        walk.propose();
+        walk.getScore();
+        walk.reject();
+        ASSERT_EQ(walk.position, 30);
+        ASSERT_EQ(walk.getScore(), 7u);
+    }
+
+    walk.propose();
+    walk.accept();
+    ASSERT_EQ(std::labs(walk.position - 30), 1);
+    ASSERT_EQ(walk.getScore(), std::size_t(std::labs(walk.position - 37)));
+}
+
+TEST(OptimisationDiscrete, TestRejectNeedsUndo) {
+    std::default_random_engine entropy(3);
+    WalkSolution walk(30, entropy);
+    ASSERT_FALSE(walk.supportsUndo());
+
+    walk.propose();
+    ASSERT_THROW(walk.reject(), std::logic_error);
+    ASSERT_EQ(walk.getScore(), std::size_t(std::labs(walk.position - 37)));
+}
+
+TEST(OptimisationDiscrete, TestSimulatedAnnealingInPlace) {
+    std::default_random_engine entropy(5);
+    hx::optimisation::discrete::SimulatedAnnealing<UndoWalkSolution> annealing(
+        UndoWalkSolution(0, entropy), 0.5, 1.0, 10000);
+
+    UndoWalkSolution::copies = 0;
+    ASSERT_EQ(annealing.fitEpoch(), 0u);
+    // only the new best solutions, one per step towards 37, are copied
+    ASSERT_EQ(UndoWalkSolution::copies, 37u);
+
+    UndoWalkSolution::copies = 0;
+    annealing.fitEpoch();
+    ASSERT_EQ(UndoWalkSolution::copies, 0u);
 }
\ No newline at end of file
@@ -0,0 +1,426 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "memory/AllocationTracker.hpp"
+#include "memory/Storage.hpp"
+#include "optimisation/discrete/ParallelTempering.hpp"
+#include "optimisation/discrete/SimulatedAnnealing.hpp"
+#include "ruleextraction/Hyperrect.hpp"
+#include "ruleextraction/PointIndex.hpp"
+#include "ruleextraction/RuleExtractor.hpp"
+#include "ruleextraction/RuleSolution.hpp"
+
+namespace {
+// two classes of points around two rule centres in the plane
+struct RuleProblem {
+    static constexpr std::size_t DIMS = 2;
+    static constexpr std::size_t STRIDE = 8;
+    static constexpr std::size_t POINTS = 64;
+
+    RuleProblem()
+        : ruleCentres(2 * STRIDE * sizeof(float))
+        , controlPoints(POINTS * STRIDE * sizeof(float))
+        , ruleClasses{0, 1}
+        , controlClasses(POINTS)
+        , entropy(11) {
+        float *centres = ruleCentres.get_as<float>();
+        centres[0] = -2.0f, centres[1] = 0.0f;
+        centres[STRIDE] = 2.0f, centres[STRIDE + 1] = 0.0f;
+
+        std::normal_distribution<float> spread(0.0f, 0.7f);
+        float *points = controlPoints.get_as<float>();
+        for (std::size_t i = 0; i < POINTS; ++i) {
+            controlClasses[i] = i % 2;
+            points[i * STRIDE] = (i % 2 ? 2.0f : -2.0f) + spread(entropy);
+            points[i * STRIDE + 1] = spread(entropy);
+        }
+    }
+
+    hx::ruleextraction::RuleSolution solution(
+        std::pmr::memory_resource *resource = nullptr,
+        const hx::ruleextraction::PointIndex *index = nullptr) {
+        return hx::ruleextraction::RuleSolution(DIMS,
+                                                STRIDE,
+                                                &ruleCentres,
+                                                &controlPoints,
+                                                controlClasses,
+                                                ruleClasses,
+                                                entropy,
+                                                resource,
+                                                index);
+    }
+
+    hx::memory::Storage ruleCentres;
+    hx::memory::Storage controlPoints;
+    std::vector<std::size_t> ruleClasses;
+    std::vector<std::size_t> controlClasses;
+    std::default_random_engine entropy;
+};
+}// namespace
+
+TEST(RuleExtraction, ParallelTemperingOnRuleSolutions) {
+    RuleProblem problem;
+    auto start = problem.solution();
+    const auto startScore = start.getScore();
+
+    hx::optimisation::discrete::ParallelTempering<hx::ruleextraction::RuleSolution>
+        tempering(start, 4, 0.5, 8.0, 20);
+
+    std::size_t best = startScore;
+    for (std::size_t epoch = 0; epoch < 50; ++epoch) {
+        auto score = tempering.fitEpoch();
+        ASSERT_LE(score, best);
+        best = score;
+    }
+
+    ASSERT_LT(best, startScore);
+    // the cached score matches the boxes it was computed for
+    auto copy = tempering.getBest();
+    copy.invalidateScore();
+    ASSERT_EQ(copy.getScore(), best);
+}
+
+TEST(RuleExtraction, ProposalsRevertInPlace) {
+    RuleProblem problem;
+    auto solution = problem.solution();
+    ASSERT_TRUE(solution.supportsUndo());
+
+    const auto score = solution.getScore();
+    const float *boxes = solution.getData();
+    const std::vector<float> original(boxes, boxes + 2 * 2 * RuleProblem::STRIDE);
+
+    for (int i = 0; i < 200; ++i) {
+        solution.propose();
+        solution.getScore();
+        solution.reject();
+
+        ASSERT_EQ(solution.getData(), boxes);
+        ASSERT_TRUE(std::equal(original.begin(), original.end(), boxes));
+        ASSERT_EQ(solution.getScore(), score);
+    }
+}
+
+TEST(RuleExtraction, AnnealingAllocatesOnlyForNewBest) {
+    RuleProblem problem;
+    hx::memory::AllocationTracker tracker;
+    hx::memory::TrackingResource boxes(tracker.counters("boxes"));
+
+    hx::optimisation::discrete::SimulatedAnnealing<hx::ruleextraction::RuleSolution>
+        annealing(problem.solution(&boxes), 1.0, 0.999, 2000);
+    annealing.fitEpoch();
+
+    // one allocation for the start, then one detach for every new best
+    auto allocations = tracker.snapshot()["boxes"].allocations;
+    ASSERT_LE(allocations, 1 + RuleProblem::POINTS * 2);
+}
+
+TEST(RuleExtraction, IncrementalScoreMatchesRescan) {
+    RuleProblem problem;
+    auto solution = problem.solution();
+    std::bernoulli_distribution keep(0.5);
+
+    auto rescanned = [](const hx::ruleextraction::RuleSolution &solution) {
+        auto copy = solution;
+        copy.getData();
+        copy.invalidateScore();
+        return copy.getScore();
+    };
+
+    ASSERT_EQ(solution.getScore(), rescanned(solution));
+    for (int i = 0; i < 500; ++i) {
+        solution.propose();
+        ASSERT_EQ(solution.getScore(), rescanned(solution));
+
+        if (keep(problem.entropy))
+            solution.accept();
+        else
+            solution.reject();
+        ASSERT_EQ(solution.getScore(), rescanned(solution));
+
+        solution.changeSolution();
+        ASSERT_EQ(solution.getScore(), rescanned(solution));
+    }
+}
+
+TEST(RuleExtraction, HyperrectKernelsMatchScalar) {
+    using hx::memory::KernelIsa;
+    std::default_random_engine entropy(7);
+    std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> extent(0.0f, 1.5f);
+
+    std::vector<KernelIsa> kernels{KernelIsa::SCALAR};
+    if (hx::memory::kernelIsa() >= KernelIsa::AVX2) kernels.push_back(KernelIsa::AVX2);
+    if (hx::memory::kernelIsa() >= KernelIsa::AVX512)
+        kernels.push_back(KernelIsa::AVX512);
+
+    for (std::size_t dims = 1; dims <= 40; ++dims) {
+        // exactly the dims floats, so a kernel reading past them would show up under
+        // a sanitizer
+        std::vector<float> point(dims), centre(dims), lower(dims), upper(dims);
+        std::size_t inside = 0;
+        for (int trial = 0; trial < 200; ++trial) {
+            for (std::size_t d = 0; d < dims; ++d) {
+                centre[d] = coordinate(entropy);
+                lower[d] = extent(entropy);
+                upper[d] = extent(entropy);
+                // mostly inside, every seventh point exactly on the upper bounds
+                point[d] = centre[d] + 0.6f * coordinate(entropy);
+                if (trial % 7 == 0) point[d] = centre[d] + upper[d];
+            }
+            const bool expected = hx::ruleextraction::insideHyperrectScalar(
+                point.data(), centre.data(), lower.data(), upper.data(), dims);
+            inside += expected;
+
+            for (auto isa : kernels)
+                ASSERT_EQ(hx::ruleextraction::insideHyperrect(point.data(),
+                                                              centre.data(),
+                                                              lower.data(),
+                                                              upper.data(),
+                                                              dims,
+                                                              isa),
+                          expected)
+                    << "dims " << dims << ", kernel " << int(isa);
+        }
+        ASSERT_GT(inside, 0u);
+    }
+}
+
+TEST(RuleExtraction, PointIndexFindsPointsInBoxes) {
+    constexpr std::size_t DIMS = 3, STRIDE = 8, POINTS = 5000;
+    std::default_random_engine entropy(13);
+    std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> extent(0.0f, 0.3f);
+
+    std::vector<float> points(POINTS * STRIDE);
+    for (std::size_t i = 0; i < POINTS; ++i)
+        for (std::size_t d = 0; d < DIMS; ++d)
+            points[i * STRIDE + d] = coordinate(entropy);
+
+    hx::ruleextraction::PointIndex index(points.data(), POINTS, DIMS, STRIDE);
+    ASSERT_TRUE(index.enabled());
+
+    std::size_t candidates = 0;
+    for (int query = 0; query < 100; ++query) {
+        float low[DIMS], high[DIMS];
+        for (std::size_t d = 0; d < DIMS; ++d) {
+            const float centre = coordinate(entropy);
+            low[d] = centre - extent(entropy);
+            high[d] = centre + extent(entropy);
+        }
+        // a point on the box boundary
+        low[0] = points[query * STRIDE];
+
+        std::vector<bool> visited(POINTS);
+        index.forEachCandidate(low, high, [&](std::size_t i) {
+            ASSERT_FALSE(visited[i]);
+            visited[i] = true;
+            ++candidates;
+        });
+
+        for (std::size_t i = 0; i < POINTS; ++i) {
+            bool inside = true;
+            for (std::size_t d = 0; d < DIMS; ++d)
+                inside &= low[d] <= points[i * STRIDE + d]
+                          && points[i * STRIDE + d] <= high[d];
+            if (inside) {
+                ASSERT_TRUE(visited[i]) << "query " << query << ", point " << i;
+            }
+        }
+    }
+    // boxes cover about 2% of the cube, the leaves around them little more
+    ASSERT_LT(candidates, 100 * POINTS / 10);
+
+    // 625 points do not fill the 2^8 cells of eight dimensions
+    hx::ruleextraction::PointIndex eightDims(points.data(), POINTS / 8, 8, STRIDE);
+    ASSERT_FALSE(eightDims.enabled());
+}
+
+TEST(RuleExtraction, IndexedScoringMatchesScan) {
+    // identical problems and move sequences, one scored through a k-d tree
+    RuleProblem scanned, indexed;
+    hx::ruleextraction::PointIndex index(indexed.controlPoints.get_as<float>(),
+                                         RuleProblem::POINTS,
+                                         RuleProblem::DIMS,
+                                         RuleProblem::STRIDE);
+    ASSERT_TRUE(index.enabled());
+
+    auto plain = scanned.solution();
+    auto fast = indexed.solution(nullptr, &index);
+    ASSERT_EQ(fast.getScore(), plain.getScore());
+
+    for (int i = 0; i < 500; ++i) {
+        plain.propose();
+        fast.propose();
+        ASSERT_EQ(fast.getScore(), plain.getScore());
+        if (i % 3 == 0) {
+            plain.reject();
+            fast.reject();
+        } else {
+            plain.accept();
+            fast.accept();
+        }
+        ASSERT_EQ(fast.getScore(), plain.getScore());
+    }
+
+    fast.getData();
+    fast.invalidateScore();
+    ASSERT_EQ(fast.getScore(), plain.getScore());
+}
+
+TEST(RuleExtraction, IndexedScoringKeepsNonFinitePoints) {
+    // insideHyperrect counts NaN coordinates as inside, the index must agree
+    RuleProblem scanned, indexed;
+    for (auto *problem : {&scanned, &indexed}) {
+        float *points = problem->controlPoints.get_as<float>();
+        points[3 * RuleProblem::STRIDE] = std::numeric_limits<float>::quiet_NaN();
+        points[10 * RuleProblem::STRIDE + 1] = std::numeric_limits<float>::quiet_NaN();
+        points[17 * RuleProblem::STRIDE] = std::numeric_limits<float>::infinity();
+    }
+    hx::ruleextraction::PointIndex index(indexed.controlPoints.get_as<float>(),
+                                         RuleProblem::POINTS,
+                                         RuleProblem::DIMS,
+                                         RuleProblem::STRIDE);
+    ASSERT_TRUE(index.enabled());
+
+    // far from every finite point, the non finite ones are still candidates
+    std::vector<bool> candidate(RuleProblem::POINTS);
+    const float low[] = {100.0f, 100.0f}, high[] = {101.0f, 101.0f};
+    index.forEachCandidate(low, high, [&](std::size_t i) { candidate[i] = true; });
+    ASSERT_TRUE(candidate[3] && candidate[10] && candidate[17]);
+
+    // a NaN bound excludes nothing
+    const float nanLow[] = {std::numeric_limits<float>::quiet_NaN(), 100.0f};
+    std::size_t visited = 0;
+    index.forEachCandidate(nanLow, high, [&](std::size_t) { ++visited; });
+    ASSERT_EQ(visited, RuleProblem::POINTS);
+
+    auto plain = scanned.solution();
+    auto fast = indexed.solution(nullptr, &index);
+    ASSERT_EQ(fast.getScore(), plain.getScore());
+
+    for (int i = 0; i < 500; ++i) {
+        plain.propose();
+        fast.propose();
+        ASSERT_EQ(fast.getScore(), plain.getScore());
+        if (i % 3 == 0) {
+            plain.reject();
+            fast.reject();
+        } else {
+            plain.accept();
+            fast.accept();
+        }
+        ASSERT_EQ(fast.getScore(), plain.getScore());
+    }
+}
+
+TEST(RuleExtraction, BitsetScoringMatchesCoverage) {
+    // identical problems and move sequences scored by the two engines
+    RuleProblem counted, bitwise;
+    hx::ruleextraction::PointIndex index(bitwise.controlPoints.get_as<float>(),
+                                         RuleProblem::POINTS,
+                                         RuleProblem::DIMS,
+                                         RuleProblem::STRIDE);
+
+    auto coverage = counted.solution();
+    auto bitset = bitwise.solution(nullptr, &index);
+    bitset.setScoringEngine(hx::ruleextraction::ScoringEngine::BITSET);
+    ASSERT_EQ(bitset.getScore(), coverage.getScore());
+
+    for (int i = 0; i < 500; ++i) {
+        coverage.propose();
+        bitset.propose();
+        ASSERT_EQ(bitset.getScore(), coverage.getScore());
+        if (i % 3 == 0) {
+            coverage.reject();
+            bitset.reject();
+        } else {
+            coverage.accept();
+            bitset.accept();
+        }
+        ASSERT_EQ(bitset.getScore(), coverage.getScore());
+
+        // copies drop the bitsets, writes through getData() rescan every rule
+        if (i % 50 == 0) {
+            auto copy = bitset;
+            copy.getData()[1] *= 2.0f;
+            copy.invalidateScore();
+            coverage.getData()[1] *= 2.0f;
+            coverage.invalidateScore();
+            ASSERT_EQ(copy.getScore(), coverage.getScore());
+            bitset = copy;
+        }
+
+        // moves made under the other engine leave no stale state behind
+        if (i % 50 == 25) {
+            bitset.setScoringEngine(hx::ruleextraction::ScoringEngine::COVERAGE);
+            coverage.setScoringEngine(hx::ruleextraction::ScoringEngine::BITSET);
+            for (int j = 0; j < 10; ++j) {
+                coverage.propose();
+                bitset.propose();
+                ASSERT_EQ(bitset.getScore(), coverage.getScore());
+                coverage.accept();
+                bitset.accept();
+            }
+            bitset.setScoringEngine(hx::ruleextraction::ScoringEngine::BITSET);
+            coverage.setScoringEngine(hx::ruleextraction::ScoringEngine::COVERAGE);
+            ASSERT_EQ(bitset.getScore(), coverage.getScore());
+        }
+    }
+}
+
+TEST(RuleExtraction, CopiesAndMovesKeepScoresExact) {
+    RuleProblem problem;
+    auto solution = problem.solution();
+    auto other = problem.solution();
+
+    auto rescanned = [](const hx::ruleextraction::RuleSolution &solution) {
+        auto copy = solution;
+        copy.getData();
+        copy.invalidateScore();
+        return copy.getScore();
+    };
+
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 20; ++i) {
+            solution.propose();
+            solution.getScore();
+            if (i % 2)
+                solution.accept();
+            else
+                solution.reject();
+        }
+
+        // copies carry the score and rebuild the coverage once they change, moves
+        // carry the coverage itself
+        auto copy = solution;
+        ASSERT_EQ(copy.getScore(), solution.getScore());
+        copy.changeSolution();
+        ASSERT_EQ(copy.getScore(), rescanned(copy));
+
+        std::swap(solution, other);
+        solution.changeSolution();
+        ASSERT_EQ(solution.getScore(), rescanned(solution));
+        other = copy;
+        ASSERT_EQ(other.getScore(), copy.getScore());
+    }
+}
+
+TEST(RuleExtraction, SuppliedControlPointsAreReadOnly) {
+    RuleProblem problem;
+    hx::ruleextraction::RuleExtractor extractor(4,
+                                                RuleProblem::DIMS,
+                                                problem.controlClasses,
+                                                problem.ruleClasses,
+                                                problem.controlPoints.share());
+
+    // e.g. a shared memory segment mapped PROT_READ, writes would fault
+    ASSERT_THROW(extractor.getControlCentres(), std::logic_error);
+    const auto &reader = extractor;
+    ASSERT_EQ(reader.getControlCentres()[RuleProblem::STRIDE],
+              problem.controlPoints.get_as<float>()[RuleProblem::STRIDE]);
+    extractor.fitEpoch();
+}
\ No newline at end of file
@@ -1,7 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <stdexcept>
+#include <thread>
+#include <vector>
+
 #include "ThreadPool.hpp"
+#include "core/DeviceCPU.hpp"
+#include "core/Stream.hpp"
 
 int test_function_pow(int x) {
     return x * x;
@@ -74,4 +80,85 @@ TEST(ThreadPoolTest, QueueExceptionMultiple) {
         input.end());
 
     ASSERT_THROW(result.get(), std::logic_error);
+}
+
+TEST(ThreadPoolTest, StreamsRunInOrder) {
+    hx::DeviceCPU device;
+    auto stream = device.createStream();
+
+    std::vector<int> order;
+    for (int i = 0; i < 100; ++i)
+        stream.enqueue([&order, i] { order.push_back(i); });
+    auto done = stream.record();
+    stream.synchronize();
+
+    ASSERT_TRUE(done.isComplete());
+    ASSERT_EQ(order.size(), 100u);
+    for (int i = 0; i < 100; ++i)
+        ASSERT_EQ(order[i], i);
+}
+
+TEST(ThreadPoolTest, StreamWaitsDoNotBlockWorkers) {
+    // a single worker, a stream blocking it while waiting would deadlock the test
+    hx::ThreadPool<> pool(1);
+    hx::Stream<hx::ThreadPool<>> ingestion(pool), scoring(pool);
+
+    hx::Event host;
+    std::atomic<int> copied{0}, scored{0};
+    ingestion.wait(host).enqueue([&copied] { copied = 1; });
+    auto ingested = ingestion.record();
+
+    scoring.wait(ingested).enqueue([&copied, &scored] { scored = copied + 1; });
+    auto independent = hx::Stream<hx::ThreadPool<>>(pool).enqueue([] {}).record();
+
+    independent.wait();
+    EXPECT_FALSE(ingested.isComplete());
+
+    host.complete();
+    scoring.synchronize();
+    ASSERT_EQ(scored, 2);
+}
+
+TEST(ThreadPoolTest, StreamErrorsPropagate) {
+    hx::ThreadPool<> pool(2);
+    hx::Stream<hx::ThreadPool<>> first(pool), second(pool);
+
+    bool skipped = true;
+    first.enqueue([] { throw std::runtime_error("failed copy"); });
+    first.enqueue([&skipped] { skipped = false; });
+    auto failed = first.record();
+
+    second.wait(failed);
+    ASSERT_THROW(second.synchronize(), std::runtime_error);
+    ASSERT_THROW(first.synchronize(), std::runtime_error);
+    ASSERT_TRUE(skipped);
+
+    // reported once, the stream is usable afterwards
+    int value = 0;
+    first.enqueue([&value] { value = 1; }).synchronize();
+    ASSERT_EQ(value, 1);
+}
+
+TEST(ThreadPoolTest, StreamWaitsOnCompletedEventsDoNotRecurse) {
+    hx::ThreadPool<> pool(1);
+    hx::Stream<hx::ThreadPool<>> stream(pool);
+
+    hx::Event ready;
+    ready.complete();
+
+    // the waits queue up behind a running item and are all passed when it ends, a
+    // stack frame per wait would overflow the worker
+    std::atomic<bool> release{false};
+    stream.enqueue([&release] {
+        while (!release)
+            std::this_thread::yield();
+    });
+    for (int i = 0; i < 300000; ++i)
+        stream.wait(ready);
+
+    bool ran = false;
+    stream.enqueue([&ran] { ran = true; });
+    release = true;
+    stream.synchronize();
+    ASSERT_TRUE(ran);
 }
\ No newline at end of file